@@ -0,0 +1,223 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Source: checkpoints of long simulation batches
+*/
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "checkpoint.h"
+
+static char rng_state[CHECKPOINT_RNG_STATE];
+
+/**
+   Seeds the random generator (rand) on a state buffer that checkpoints
+   can save and restore
+*/
+void checkpoint_rng_init(unsigned int seed) {
+  initstate(seed, rng_state, CHECKPOINT_RNG_STATE);
+}
+
+/**
+   Re-selecting the active buffer stores the generator's position into it
+*/
+void checkpoint_rng_save(char *state) {
+  setstate(rng_state);
+  memcpy(state, rng_state, CHECKPOINT_RNG_STATE);
+}
+
+/**
+   Selecting a buffer stores the position of the active one into it: the
+   generator moves to a scratch buffer first, so that the position copied
+   into rng_state is not overwritten
+*/
+void checkpoint_rng_restore(char *state) {
+  static char scratch[CHECKPOINT_RNG_STATE];
+  initstate(1, scratch, CHECKPOINT_RNG_STATE);
+  memcpy(rng_state, state, CHECKPOINT_RNG_STATE);
+  setstate(rng_state);
+}
+
+/**
+   Writes a checkpoint to a temporary file, then renames it over 'path',
+   once the outputs up to the recorded offsets are on disk
+*/
+static void checkpoint_write(Checkpointer *ckp, Checkpoint *ck) {
+  int i;
+  FILE *out;
+  char tmp_path[4096];
+
+  if (ckp->trace)
+    fsync(fileno(ckp->trace));
+  if (ckp->status && ck->status_offset >= 0)
+    fsync(fileno(ckp->status));
+  if (ckp->results)
+    fsync(fileno(ckp->results));
+  if (ckp->branches)
+    fsync(fileno(ckp->branches));
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", ckp->path);
+  out = fopen(tmp_path, "w");
+  assert(out != NULL);
+  fprintf(out, "SIRCHECKPOINT 1\n");
+  fprintf(out, "seed %u\n", ck->seed);
+  fprintf(out, "completed %d\n", ck->completed);
+  fprintf(out, "last_id %d\n", ck->last_id);
+  fprintf(out, "trace_offset %ld\n", ck->trace_offset);
+  fprintf(out, "status_offset %ld\n", ck->status_offset);
+  fprintf(out, "rng ");
+  for (i = 0; i < CHECKPOINT_RNG_STATE; i++)
+    fprintf(out, "%02x", (unsigned char) ck->rng[i]);
+  fprintf(out, "\n");
+  fprintf(out, "results_offset %ld\n", ck->results_offset);
+  fprintf(out, "branch_offset %ld\n", ck->branch_offset);
+  fflush(out);
+  fsync(fileno(out));
+  fclose(out);
+  if (rename(tmp_path, ckp->path) != 0)
+    perror("checkpoint: rename");
+}
+
+static void *checkpoint_writer(void *arg) {
+  Checkpointer *ckp = (Checkpointer *) arg;
+  Checkpoint ck;
+
+  pthread_mutex_lock(&ckp->lock);
+  for (;;) {
+    while (!ckp->has_pending && !ckp->done)
+      pthread_cond_wait(&ckp->cond, &ckp->lock);
+    if (!ckp->has_pending)
+      break;
+    ck = ckp->pending;
+    ckp->has_pending = 0;
+    pthread_mutex_unlock(&ckp->lock);
+    checkpoint_write(ckp, &ck);
+    pthread_mutex_lock(&ckp->lock);
+  }
+  pthread_mutex_unlock(&ckp->lock);
+  return NULL;
+}
+
+Checkpointer *checkpointer_new(char *path, int period, unsigned int seed,
+				FILE *trace, FILE *status, FILE *results, FILE *branches) {
+  Checkpointer *ckp = (Checkpointer *) calloc(1, sizeof(Checkpointer));
+  assert(ckp != NULL);
+  assert(path != NULL && period >= 0);
+  ckp->path   = path;
+  ckp->period = period;
+  ckp->seed   = seed;
+  ckp->last   = time(NULL);
+  ckp->trace  = trace;
+  ckp->status = (status && status != stderr && status != stdout)? status : NULL;
+  ckp->results = results;
+  ckp->branches = branches;
+  pthread_mutex_init(&ckp->lock, NULL);
+  pthread_cond_init(&ckp->cond, NULL);
+  if (pthread_create(&ckp->writer, NULL, checkpoint_writer, ckp) != 0) {
+    perror("checkpointer_new: pthread_create");
+    exit(-1);
+  }
+  return ckp;
+}
+
+int checkpointer_due(Checkpointer *ckp) {
+  return (time(NULL) - ckp->last >= ckp->period);
+}
+
+void checkpointer_post(Checkpointer *ckp, int completed, int last_id) {
+  Checkpoint ck;
+  ck.seed          = ckp->seed;
+  ck.completed     = completed;
+  ck.last_id       = last_id;
+  ck.trace_offset  = 0;
+  ck.status_offset = -1;
+  ck.results_offset = -1;
+  ck.branch_offset = -1;
+  if (ckp->trace) {
+    fflush(ckp->trace);
+    ck.trace_offset = ftell(ckp->trace);
+  }
+  if (ckp->status) {
+    fflush(ckp->status);
+    ck.status_offset = ftell(ckp->status);
+  }
+  if (ckp->results) {
+    fflush(ckp->results);
+    ck.results_offset = ftell(ckp->results);
+  }
+  if (ckp->branches) {
+    fflush(ckp->branches);
+    ck.branch_offset = ftell(ckp->branches);
+  }
+  checkpoint_rng_save(ck.rng);
+  ckp->last = time(NULL);
+
+  pthread_mutex_lock(&ckp->lock);
+  ckp->pending     = ck;  // a checkpoint not yet written is superseded
+  ckp->has_pending = 1;
+  pthread_cond_signal(&ckp->cond);
+  pthread_mutex_unlock(&ckp->lock);
+}
+
+void checkpointer_destroy(Checkpointer *ckp) {
+  assert(ckp != NULL);
+  pthread_mutex_lock(&ckp->lock);
+  ckp->done = 1;
+  pthread_cond_signal(&ckp->cond);
+  pthread_mutex_unlock(&ckp->lock);
+  pthread_join(ckp->writer, NULL);
+  pthread_mutex_destroy(&ckp->lock);
+  pthread_cond_destroy(&ckp->cond);
+  free(ckp);
+}
+
+/**
+   Reads a checkpoint file; returns 0 if there is none
+*/
+int checkpoint_load(char *path, Checkpoint *ck) {
+  int i, version, tokens_read;
+  unsigned int byte;
+  FILE *input = fopen(path, "r");
+  if (input == NULL)
+    return 0;
+  tokens_read = fscanf(input, "SIRCHECKPOINT %d\n", &version);
+  assert(tokens_read == 1 && version == 1);
+  tokens_read  = fscanf(input, "seed %u\n", &ck->seed);
+  tokens_read += fscanf(input, "completed %d\n", &ck->completed);
+  tokens_read += fscanf(input, "last_id %d\n", &ck->last_id);
+  tokens_read += fscanf(input, "trace_offset %ld\n", &ck->trace_offset);
+  tokens_read += fscanf(input, "status_offset %ld\n", &ck->status_offset);
+  tokens_read += fscanf(input, "rng ");
+  assert(tokens_read == 5);
+  for (i = 0; i < CHECKPOINT_RNG_STATE; i++) {
+    tokens_read = fscanf(input, "%2x", &byte);
+    assert(tokens_read == 1);
+    ck->rng[i] = (char) byte;
+  }
+  if (fscanf(input, " results_offset %ld\n", &ck->results_offset) != 1)
+    ck->results_offset = -1; // written by an older version
+  if (fscanf(input, " branch_offset %ld\n", &ck->branch_offset) != 1)
+    ck->branch_offset = -1;
+  fclose(input);
+  assert(ck->completed >= 0 && ck->trace_offset >= 0);
+  return 1;
+}
+
+/**
+   Reopens an output file for appending after truncating it to 'offset'
+*/
+FILE *checkpoint_reopen(char *path, long offset) {
+  FILE *f = fopen(path, "r+");
+  assert(f != NULL); // the outputs of a resumed run must still be there
+  if (ftruncate(fileno(f), offset) != 0)
+    perror("checkpoint_reopen: ftruncate");
+  fseek(f, 0, SEEK_END);
+  return f;
+}
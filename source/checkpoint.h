@@ -0,0 +1,89 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Header: checkpoints of long simulation batches
+*/
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#define CHECKPOINT_RNG_STATE 256  // bytes of state of the random generator
+
+typedef struct _Checkpoint {
+  unsigned int seed;       // seed of the random generator at startup
+  int completed;           // number of completed epidemics, in input order
+  int last_id;             // id of the last completed epidemic
+  long trace_offset;       // size of the trace output after it
+  long status_offset;      // size of the status output after it (-1: none)
+  long results_offset;     // size of the table of results after it (-1: none)
+  long branch_offset;      // size of the trace of the branches after it (-1: none)
+  char rng[CHECKPOINT_RNG_STATE]; // state of the random generator
+} Checkpoint;
+
+typedef struct _Checkpointer {
+  char *path;              // checkpoint file (replaced atomically)
+  int period;              // minimum delay between checkpoints (seconds)
+  unsigned int seed;       // seed of the random generator at startup
+  time_t last;             // time of the last posted checkpoint
+  FILE *trace;             // trace output (may be NULL)
+  FILE *status;            // status output (may be NULL)
+  FILE *results;           // table of results (may be NULL)
+  FILE *branches;          // trace of the branches (may be NULL)
+  Checkpoint pending;      // latest posted, not yet written, checkpoint
+  int has_pending;
+  int done;
+  pthread_t writer;        // background writer thread
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+} Checkpointer;
+
+/**
+   Seeds the random generator (rand) on a state buffer that checkpoints
+   can save and restore
+*/
+void checkpoint_rng_init(unsigned int seed);
+void checkpoint_rng_save(char *state);
+void checkpoint_rng_restore(char *state);
+
+/**
+   Starts a background writer of checkpoints into 'path', taken at most
+   every 'period' seconds; output offsets are read from trace, status,
+   results and branches
+*/
+Checkpointer *checkpointer_new(char *path, int period, unsigned int seed,
+			       FILE *trace, FILE *status, FILE *results, FILE *branches);
+
+/**
+   Returns true if the period since the last checkpoint has elapsed
+*/
+int checkpointer_due(Checkpointer *ckp);
+
+/**
+   Snapshots the run after 'completed' epidemics (last one: 'last_id') and
+   hands it to the writer; never waits for the disk
+*/
+void checkpointer_post(Checkpointer *ckp, int completed, int last_id);
+
+/**
+   Writes the last posted checkpoint and stops the writer
+*/
+void checkpointer_destroy(Checkpointer *ckp);
+
+/**
+   Reads a checkpoint file; returns 0 if there is none
+*/
+int checkpoint_load(char *path, Checkpoint *ck);
+
+/**
+   Reopens an output file for appending after truncating it to 'offset'
+*/
+FILE *checkpoint_reopen(char *path, long offset);
+
+#endif
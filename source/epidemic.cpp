@@ -9,15 +9,16 @@
   Source: epidemic evolution
 */
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include <iostream>
 #include <algorithm>
 #include <vector>
 #include <limits>
 #include <string>
-#include <sstream>
-#include <fstream>
 
 #include "epidemic.hpp"
+#include "listfile.h"
 #include "randfuncs.c"
 
 #define VERBOSE 1
@@ -27,32 +28,32 @@
 using namespace std;
 
 // Epidemic class
-Epidemic::Epidemic(Graph *gr, FILE *outp) {
+Epidemic::Epidemic(Graph *gr, TraceWriter *outp, TraceStats *st) {
   assert(gr != NULL);
   assert(gr->n > 0);
   graph    = gr;
   output   = outp;
-  removed  = new int[graph->n];
-  infected = new int[graph->n];
-  infctime = new int[graph->n];
-  visitedn = new int[graph->n];
-  depth    = new int[graph->n];
+  stats    = st;
+  branchoutput = NULL;
+  traced   = false;
+  stamps   = 0;
+  state    = new NodeState[graph->n];
   connections.resize(graph->n);
-  fill_n(depth,   graph->n,UNSETVAL);
-  fill_n(removed, graph->n,UNSETVAL);
-  fill_n(infected,graph->n,UNSETVAL);
-  fill_n(infctime,graph->n,UNSETVAL);
+  for (int u = 0; u < graph->n; u++) {
+    state[u].stamp    = UNSETVAL;
+    state[u].infctime = UNSETVAL;
+    state[u].visitedn = 0;
+    state[u].depth    = 0;
+    state[u].removed  = 0;
+  }
 }
 
 Epidemic::~Epidemic() {
-  delete[] depth;
-  delete[] removed;
-  delete[] infected;
-  delete[] infctime;
-  delete[] visitedn;
+  delete[] state;
 }
 void Epidemic::setup(InitialCondition *ic) {
   assert(ic->id >= 0);
+  unswap(0); // the rows as read, whatever the epidemics before
   id            = ic->id;
   bound         = ic->bound;
   mu            = ic->mu;
@@ -62,58 +63,110 @@ void Epidemic::setup(InitialCondition *ic) {
   num_infected  = ic->num_infected;
   cascade_links = 0;
   max_depth     = 0;
+  stamp         = ++stamps;
+  branchn       = 0;
+  traced        = output && tracewriter_begin(output, id, 0);
 }
 
-inline void Epidemic::nodeinfect(int v)  { infected[v]= id; }
-inline void Epidemic::noderemove(int u)  { removed[u] = id; }
-inline bool Epidemic::nodeinfected(int u){ return (infected[u]== id); }
-inline bool Epidemic::noderemoved(int u) { return (removed[u] == id); }
+inline void Epidemic::nodeinfect(int v)  {
+  state[v].stamp    = stamp;
+  state[v].visitedn = 0;
+  state[v].removed  = 0;
+  infectedl.push_back(v);
+}
+inline void Epidemic::noderemove(int u)  { state[u].removed = 1; } // u is infected
+inline bool Epidemic::nodeinfected(int u){ return (state[u].stamp == stamp); }
+inline bool Epidemic::noderemoved(int u) { return (state[u].stamp == stamp && state[u].removed); }
 inline bool Epidemic::nodedown(int u,int t) {
   return (t > connections[u].second); } 
 inline bool Epidemic::nodeonline(int u,int t) {
   return (t >= connections[u].first && t <= connections[u].second); }
+inline void Epidemic::trace(int t, int u, int v) {
+  if (branchn) {
+    if (branchoutput)
+      tracewriter_event(branchoutput,t,u,v);
+    return;
+  }
+  if (traced) // sampled epidemics only
+    tracewriter_event(output,t,u,v);
+  if (stats)
+    tracestats_event(stats,t);
+}
 
 /**
    Runs epidemic up to the specified time bound
 */
 int Epidemic::simulate() {
-  int i,u,v,t,dt,randindex;
-  fill_n(visitedn,graph->n,0); // reset number of infected neighbors
-  fill_n(depth,   graph->n,0); // reset number of infected neighbors
+  start();
+  return run(numeric_limits<int>::max());
+}
+
+/**
+   Activates the initial grains; nodes are reset as they get infected, so
+   that only the nodes touched by the epidemic are written
+*/
+void Epidemic::start() {
+  int i,v,t;
+  infectedl.clear();
+  ActiveNodes = priority_queue<NodeAction, vector<NodeAction >, Smaller2nd >();
+  last_time = 0;
 
   // activate initial grains
   for (i = 0; i < num_infected; i++) {
     v = initiali[i];
     t = initialt[i];
     nodeinfect(v);
-    depth[v] = 1;
-    infctime[v] = -t; // negative to mark initial nodes
+    state[v].depth    = 1;
+    state[v].infctime = -t; // negative to mark initial nodes
     ActiveNodes.push(NodeAction(v,t));
+    last_time = max(last_time,t);
     #if VERBOSE > 1
     cout << "push: (" << v << "," << t << ")" << endl;
     #endif
   }
 
   max_depth = 1;
+}
+
+/**
+   Runs the events of the epidemic up to time 'until'; returns the time
+   of the last event run so far (that of the initial grains if none)
+*/
+int Epidemic::run(int until) {
+  int u,v,w,t=last_time,dt,randindex,d;
+  NodeState *su, *sv;
+  LinkSwap ls;
 
   // run the epidemic
-  while (!ActiveNodes.empty()) {
+  while (!ActiveNodes.empty() && ActiveNodes.top().second <= until) {
     u = ActiveNodes.top().first;  // current provider
     t = ActiveNodes.top().second; // current time
     ActiveNodes.pop();
+    if (!ActiveNodes.empty()) { // likely the next provider: its misses overlap this one
+      w = ActiveNodes.top().first;
+      __builtin_prefetch(state + w);
+      __builtin_prefetch(graph->links[w]);
+      __builtin_prefetch(graph->degrees + w);
+      __builtin_prefetch(&connections[w]);
+    }
+    su = state + u;
     noderemove(u);
     #if VERBOSE > 1
     cout << "pop: (" << u << "," << t << ")" << endl;
     #endif
     
     // select a random neighbor from u, which was not visited by u
-    randindex = rand() % (graph->degrees[u]-visitedn[u]);
+    randindex = rand() % (graph->degrees[u]-su->visitedn);
     v = graph->links[u][randindex];
+    sv = state + v;
     if (nodeonline(v,t) || nodedown(v,t)) {
       // can be consided from now on visited by v
-      swap(graph->links[u][randindex],
-	   graph->links[u][(graph->degrees[u]-visitedn[u])-1]);
-      visitedn[u]++;
+      ls.u = u;
+      ls.i = randindex;
+      ls.j = (graph->degrees[u]-su->visitedn)-1;
+      swap(graph->links[u][ls.i], graph->links[u][ls.j]);
+      swaps.push_back(ls);
+      su->visitedn++;
     }
     #if VERBOSE > 1
     cout << u << " --> " << v 
@@ -128,9 +181,11 @@ int Epidemic::simulate() {
 	num_infected++;
 	
 	nodeinfect(v);
-	infctime[v] = t;
-	depth[v] = depth[u]+1;
-	max_depth= max(max_depth,depth[v]);
+	sv->infctime = t;
+	sv->depth    = su->depth+1;
+	max_depth= max(max_depth,(int)sv->depth);
+	if (stats && !branchn)
+	  tracestats_infection(stats,t,sv->depth);
 
 	if (mu[v] > EPSILON) { // ie, mu != 0.0
 	  dt = g2rand(mu[v]);
@@ -143,21 +198,20 @@ int Epidemic::simulate() {
 		 <<(nodeonline(v,t+dt)?"Yes" : "No")<< endl;
           #endif
 	}
-	if (output) // print output: t P C F
-	  fprintf(output, "%d %d %d %d\n",t,u,v,id);
+	trace(t,u,v); // print output: t P C F
 	
-      } else if (nodeinfected(v) && !noderemoved(v) && infctime[v] == t) {
+      } else if (nodeinfected(v) && !sv->removed && sv->infctime == t) {
 	cascade_links++;
-	depth[v] = max(depth[v],depth[u]+1);
-	max_depth= max(depth[v],max_depth);
-	if (output) // print output: t P C F
-	  fprintf(output, "%d %d %d %d\n",t,u,v,id);
+	d = max((int)sv->depth,(int)su->depth+1);
+	sv->depth = d;
+	max_depth= max(d,max_depth);
+	trace(t,u,v); // print output: t P C F
       }
     }
     
     // keep u active if within activity bounds
-    if (mu[u] > EPSILON && graph->degrees[u] > visitedn[u]) {
-      dt = g2rand(mu[u]*graph->degrees[u]/(graph->degrees[u]-visitedn[u]));
+    if (mu[u] > EPSILON && graph->degrees[u] > su->visitedn) {
+      dt = g2rand(mu[u]*graph->degrees[u]/(graph->degrees[u]-su->visitedn));
       #if VERBOSE > 1
       cout <<"self push attempt: ("<<u<<"," <<t+dt<<") -- "
 	   << "nodeonline(" <<u<<","<<t+dt<<"): "
@@ -171,24 +225,144 @@ int Epidemic::simulate() {
       }
     }
   }
+  last_time = t;
   return t;
 }
 
-void Epidemic::readconnections(char* path) {
-  int login,logout,u;
-  string line;
-  ifstream infile(path);
+/**
+   Saves the state of the epidemic after the events up to time 'until'
+*/
+void Epidemic::snapshot(EpidemicSnapshot *snap, int until) {
+  int k,v;
+  snap->id            = id;
+  snap->time          = until;
+  snap->last_time     = last_time;
+  snap->max_depth     = max_depth;
+  snap->num_infected  = num_infected;
+  snap->cascade_links = cascade_links;
+  snap->nodes         = infectedl;
+  snap->infctime.resize(infectedl.size());
+  snap->depth.resize(infectedl.size());
+  snap->visitedn.resize(infectedl.size());
+  snap->removed.resize(infectedl.size());
+  for (k = 0; k < (int)infectedl.size(); k++) {
+    v = infectedl[k];
+    snap->infctime[k] = state[v].infctime;
+    snap->depth[k]    = state[v].depth;
+    snap->visitedn[k] = state[v].visitedn;
+    snap->removed[k]  = state[v].removed;
+  }
+  snap->ActiveNodes   = ActiveNodes;
+  snap->swaps         = swaps.size();
+}
+
+/**
+   Restores a snapshot as branch 'b', whose trace goes to 'outp': the
+   snapshot is only read, and a fresh stamp invalidates the nodes touched
+   by the previous branch, so a restore costs the size of the snapshot
+   and the swaps of links rows undone
+*/
+void Epidemic::branch(EpidemicSnapshot *snap, int b, TraceWriter *outp) {
+  int k,v;
+  assert(snap->id == id && b > 0);
+  stamp         = ++stamps;
+  branchn       = b;
+  branchoutput  = outp;
+  if (branchoutput && !tracewriter_begin(branchoutput, id, b))
+    branchoutput = NULL; // not sampled
+  last_time     = snap->last_time;
+  max_depth     = snap->max_depth;
+  num_infected  = snap->num_infected;
+  cascade_links = snap->cascade_links;
+  infectedl     = snap->nodes;
+  for (k = 0; k < (int)snap->nodes.size(); k++) {
+    v = snap->nodes[k];
+    state[v].stamp    = stamp;
+    state[v].removed  = snap->removed[k];
+    state[v].infctime = snap->infctime[k];
+    state[v].depth    = snap->depth[k];
+    state[v].visitedn = snap->visitedn[k];
+  }
+  ActiveNodes   = snap->ActiveNodes;
+  unswap(snap->swaps); // the rows as at the snapshot
+}
 
+/**
+   Undoes the swaps of links rows made after the first 'keep' ones, so
+   that the neighbors drawn do not depend on the runs before: a run
+   resumed from a checkpoint draws the same ones
+*/
+void Epidemic::unswap(size_t keep) {
+  while (swaps.size() > keep) {
+    LinkSwap &s = swaps.back();
+    swap(graph->links[s.u][s.i], graph->links[s.u][s.j]);
+    swaps.pop_back();
+  }
+}
+
+/**
+   Reads the lines <node> <login> <logout> of the nodes, in order, or the
+   binary form of the list (login, logout pairs), up to the end of the
+   list or to the first row missing or out of order: the graph is not
+   needed, so that the list can be loaded along with it. 'error' is what
+   is thrown if the graph has more nodes than the 'rows' read.
+*/
+int *import_connections(char* path, int *rows, int *error) {
+  int u, capacity = 0, *pairs = NULL;
+  const int *binary;
+  FILE *input = fopen(path, "r");
+  *rows  = 0;
+  *error = 10;
+  if (!input)
+    return NULL;
+  ListFile *lf = listfile_open(input);
+  if (lf->type) {
+    if (lf->type == LIST_CONNECTIONS &&
+	(binary = (const int *) listfile_array(lf, 2L*lf->rows*sizeof(int)))) {
+      *rows = (int) lf->rows;
+      pairs = (int *) malloc((2L*(*rows)+1)*sizeof(int));
+      assert(pairs != NULL);
+      memcpy(pairs, binary, 2L*(*rows)*sizeof(int));
+    }
+  } else
+    for (;;) {
+      if (*rows == capacity) {
+	capacity = capacity? 2*capacity : 1024;
+	pairs = (int *) realloc(pairs, 2L*capacity*sizeof(int));
+	assert(pairs != NULL);
+      }
+      if (!listfile_int(lf,&u))
+	break;
+      if (u != *rows) {
+	*error = 11;
+	break;
+      }
+      if (!listfile_int(lf,pairs+2*(*rows)) || !listfile_int(lf,pairs+2*(*rows)+1))
+	break;
+      (*rows)++;
+    }
+  listfile_close(lf, "connections");
+  fclose(input);
+  return pairs;
+}
+
+/**
+   Sets the connections of the nodes of the graph, as read by
+   import_connections (same errors as readconnections)
+*/
+void Epidemic::setconnections(int *pairs, int rows, int error) {
+  if (rows < graph->n)
+    { throw error; }
   for(int i=0; i<graph->n; i++) {
-    getline(infile, line);
-    istringstream iss(line);
-    if (!(iss >> u >> login >> logout))
-      { throw 10; }
-    if (u != i)
-      { throw 11; }
-    if (login < 0 || login > logout)
+    if (pairs[2*i] < 0 || pairs[2*i] > pairs[2*i+1])
       { throw 12; }
-    connections[i] = pair<int,int>(login,logout);
-  }  
-  infile.close();
+    connections[i] = pair<int,int>(pairs[2*i],pairs[2*i+1]);
+  }
+}
+
+void Epidemic::readconnections(char* path) {
+  int rows, error;
+  int *pairs = import_connections(path, &rows, &error);
+  setconnections(pairs, rows, error);
+  free(pairs);
 }
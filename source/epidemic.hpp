@@ -15,9 +15,17 @@
 #include <stdio.h>
 #include "graph.h"
 #include "initialcondition.h"
+#include "tracefile.h"
+#include "tracestats.h"
 
 using namespace std;
 
+/**
+   Connection list, read without the graph: login, logout pairs of the
+   'rows' first nodes (see Epidemic::readconnections)
+*/
+int *import_connections(char* path, int *rows, int *error);
+
 #define NodeAction pair<int,int>
 
 class Smaller2nd {
@@ -26,23 +34,69 @@ public:
     return p1.second > p2.second; }
 };
 
+/**
+   State of a node, packed so that infecting or visiting it touches a
+   single cache line; it belongs to the run whose stamp it holds, so
+   that the nodes are only reset as they get infected
+*/
+struct NodeState {
+  int stamp;                // infected in the run of this stamp
+  int infctime;             // infection time (negative for initial nodes)
+  int visitedn;             // number of neighbors visited by the node
+  unsigned int depth   : 31;// depth in the cascade (up to n)
+  unsigned int removed : 1; // removed in the run of the stamp
+};
+
+/**
+   Swap of the entries i and j of links[u], made as u visits a neighbor
+*/
+struct LinkSwap {
+  int u, i, j;
+};
+
+/**
+   State of an epidemic at a given time, from which several continuations
+   can be branched; only the nodes infected so far are stored
+*/
+class EpidemicSnapshot {
+public:
+  int id;
+  int time;                 // snapshot time: events up to it are done
+  int last_time;            // time of the last event done
+  int max_depth;
+  int num_infected;
+  int cascade_links;
+  vector<int> nodes;        // infected nodes, and their state:
+  vector<int> infctime;
+  vector<int> depth;
+  vector<int> visitedn;     // visited overlay: the last visitedn entries
+  vector<bool> removed;     // of links[u] stay fixed once visited
+  size_t swaps;             // swaps of links rows made up to the snapshot
+  priority_queue<NodeAction, vector<NodeAction > , Smaller2nd > ActiveNodes;
+};
+
 class Epidemic {
 private:
   int *initiali;            // list of initial inf nodes' id
   int *initialt;            // list of initial inf nodes' activation time
-  int *infected;            // set of all infected nodes
-  int *infctime;            // set of all infected nodes
-  int *removed;             // set of all infected nodes
-  int *visitedn;            // number of infected neighbors for each node
-  int *depth;
+  NodeState *state;         // per node, valid for the nodes of this stamp
   priority_queue<NodeAction, vector<NodeAction > , Smaller2nd > ActiveNodes;
   vector<pair<int,int> > connections;
+  vector<int> infectedl;    // list of the nodes infected in this run
+  vector<LinkSwap> swaps;   // swaps of links rows in this epidemic
   int id;                   // epidemic id
+  int stamp;                // mark of this run in infected/removed
+  int stamps;               // last stamp used
+  int branchn;              // branch number (0: not a branch)
   int bound;                // time bound on epidemic evolution
+  int last_time;            // time of the last event run
   double p;
   double *mu;               // activity rate: inv. of mean inter event time
   Graph *graph;             // underlying graph (network)
-  FILE *output;             // trace output
+  TraceWriter *output;      // trace output
+  bool traced;              // the epidemic is in the sample of the trace
+  TraceWriter *branchoutput;// trace output of the branches
+  TraceStats *stats;        // aggregate statistics (not of the branches)
 
 public:
   int max_depth;
@@ -50,10 +104,16 @@ public:
   int cascade_links;      // number of arcs in the infection cascade
 
   ~Epidemic();
-  Epidemic(Graph *gr, FILE *output);
+  Epidemic(Graph *gr, TraceWriter *output, TraceStats *stats);
   void setup(InitialCondition *ic);
   void readconnections(char* path);
+  void setconnections(int *pairs, int rows, int error);
   int simulate();
+  void start();
+  int run(int until);
+  void snapshot(EpidemicSnapshot *snap, int until);
+  void branch(EpidemicSnapshot *snap, int b, TraceWriter *outp);
+  void unswap(size_t keep);
 
   void nodeinfect(int u);
   void noderemove(int u);
@@ -61,5 +121,6 @@ public:
   bool noderemoved(int u);
   bool nodeonline(int u, int t);
   bool nodedown(int u, int t);
+  void trace(int t, int u, int v);
 };
 #endif
@@ -0,0 +1,189 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Graph partitioner: cuts a graph into the parts (see partition.h) of a
+  distributed simulation. The graph is renumbered in breadth first order,
+  so that neighbours get close numbers, then cut into ranges of about the
+  same number of nodes plus arcs; each part is written to PREFIX.partK
+  with its ghost table. The whole graph is loaded here, once, on a host
+  with the memory for it; the simulation processes load their part only.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include "graph.h"
+#include "partition.h"
+
+/**
+   Breadth first numbering of the nodes of 'g', each component from its
+   smallest node: perm[u] is the new number of u
+*/
+static int *graphpart_bfs(Graph *g) {
+  int i, u, v, head, tail = 0, next = 0;
+  int *perm = (int *) malloc(g->n * sizeof(int));
+  int *queue = (int *) malloc(g->n * sizeof(int));
+  assert(perm != NULL && queue != NULL);
+
+  for (u = 0; u < g->n; u++)
+    perm[u] = -1;
+  for (u = 0; u < g->n; u++) {
+    if (perm[u] >= 0)
+      continue;
+    head = tail = 0;
+    queue[tail++] = u;
+    perm[u] = next++;
+    while (head < tail) {
+      v = queue[head++];
+      for (i = 0; i < g->degrees[v]; i++)
+	if (perm[g->links[v][i]] < 0) {
+	  perm[g->links[v][i]] = next++;
+	  queue[tail++] = g->links[v][i];
+	}
+    }
+  }
+  free(queue);
+  return perm;
+}
+
+/**
+   Writes the 'num_parts' parts of 'g', renumbered by 'perm' (ids: the
+   numbers before), to PREFIX.partK; returns the total number of ghosts
+*/
+static long graphpart_write(Graph *g, int *perm, int num_parts, const char *prefix) {
+  int i, k, u, v, x, owned, ghosts;
+  long arcs, total = 0, cut = 0, sum = 0, all_ghosts = 0;
+  int *owner = (int *) malloc(g->n * sizeof(int));  // by new number
+  int *local = (int *) malloc(g->n * sizeof(int));  // in the owner part
+  int *mark  = (int *) malloc(g->n * sizeof(int));  // ghost of part mark[u] ...
+  int *slot  = (int *) malloc(g->n * sizeof(int));  // ... as local node slot[u]
+  int *count = (int *) calloc(num_parts, sizeof(int));
+  int *order = (int *) malloc(g->n * sizeof(int));  // owned nodes, by id
+  int *old   = (int *) malloc(g->n * sizeof(int));  // id of each new number
+  char path[4096];
+  GraphPart *gp;
+  FILE *out;
+
+  assert(owner && local && mark && slot && count && order && old);
+  for (u = 0; u < g->n; u++) {
+    old[perm[u]] = u;
+    total += g->degrees[u] + 1;
+  }
+  for (u = 0, k = 0; u < g->n; u++) { // ranges of about total / num_parts
+    owner[u] = k;
+    sum += g->degrees[u] + 1;
+    if (k < num_parts-1 && sum >= total * (k+1) / num_parts)
+      k++;
+  }
+  for (x = 0; x < g->n; x++) { // the owned nodes of each part in order of id
+    u = perm[x];
+    local[u] = count[owner[u]]++;
+  }
+  for (u = 0; u < g->n; u++)
+    mark[u] = -1;
+
+  for (k = 0; k < num_parts; k++) {
+    for (owned = 0, x = 0; x < g->n; x++)
+      if (owner[perm[x]] == k)
+	order[owned++] = perm[x];
+    assert(owned == count[k]);
+    ghosts = 0;
+    arcs = 0;
+    for (i = 0; i < owned; i++) {
+      u = order[i];
+      arcs += g->degrees[u];
+      for (x = 0; x < g->degrees[u]; x++) {
+	v = g->links[u][x];
+	if (owner[v] != k && mark[v] != k) {
+	  mark[v] = k;
+	  slot[v] = owned + ghosts++;
+	}
+      }
+    }
+    gp = partition_new(k, num_parts, g->n, owned, ghosts, arcs);
+    for (i = 0, arcs = 0; i < owned; i++) {
+      u = order[i];
+      gp->ids[i] = old[u];
+      for (x = 0; x < g->degrees[u]; x++) {
+	v = g->links[u][x];
+	if (owner[v] == k)
+	  gp->targets[arcs++] = local[v];
+	else {
+	  gp->targets[arcs++] = slot[v];
+	  gp->ids[slot[v]]                 = old[v];
+	  gp->ghost_part[slot[v] - owned]  = owner[v];
+	  gp->ghost_index[slot[v] - owned] = local[v];
+	  cut++;
+	}
+      }
+      gp->offsets[i+1] = arcs;
+    }
+    out = fopen(partition_path(path, prefix, k), "w");
+    assert(out != NULL);
+    partition_write(gp, out);
+    fclose(out);
+    fprintf(stderr, "  Part %d: %d nodes, %ld arcs, %d ghosts.\n", k, owned, arcs, ghosts);
+    all_ghosts += ghosts;
+    partition_destroy(gp);
+  }
+  fprintf(stderr, "  %ld of %ld arcs between parts.\n", cut, 2L * g->m);
+
+  free(owner);
+  free(local);
+  free(mark);
+  free(slot);
+  free(count);
+  free(order);
+  free(old);
+  return all_ghosts;
+}
+
+int main(int argc, char **argv) {
+  int i, old_0, *perm, num_parts = 0;
+  char *prefix = NULL;
+  FILE *in = stdin;
+  Graph *g;
+  char syntax[] = "\n\
+ Usage: graphpart -n NUM_PARTS -o PREFIX [GRAPH_PATH] (default: standard input)\n\n\
+ Writes the parts PREFIX.part0 .. PREFIX.part<NUM_PARTS-1>\n";
+
+  while ((i = getopt(argc, argv, "n:o:")) != -1)
+    switch (i) {
+    case 'n':
+      num_parts = atoi(optarg);
+      break;
+    case 'o':
+      prefix = optarg;
+      break;
+    case '?':
+      fputs(syntax, stderr);
+    default:
+      abort();
+    }
+  if (num_parts <= 0 || !prefix) {
+    fputs(syntax, stderr);
+    exit(1);
+  }
+  if (optind < argc)
+    in = fopen(argv[optind], "r");
+  assert(in != NULL);
+  g = graph_from_file(in);
+  if (in != stdin)
+    fclose(in);
+  assert(num_parts <= g->n);
+  fprintf(stderr, "Loaded graph with %d nodes, %d links.\n", g->n, g->m);
+
+  perm = graphpart_bfs(g);
+  old_0 = (g->n > 0)? perm[0] : -1;
+  renumbering(g, perm); // links and degrees by new number
+  fprintf(stderr, "%ld ghosts in all.\n", graphpart_write(g, perm, num_parts, prefix));
+  free(perm);
+  free_graph_old_start(g, old_0);
+  return 0;
+}
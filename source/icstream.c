@@ -0,0 +1,218 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Source: streamed list of initial conditions
+*/
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "icstream.h"
+
+/**
+   Parses the next epidemic of the list (and its bound) into record 'k'
+   of the batch; the arena may move, so the records keep offsets until
+   the batch is full
+*/
+static void icstream_record(ICStream *s, ICBatch *b, int k, long *used) {
+  int j, id, num_infected, tokens_read;
+  const int *row;
+  ICRecord *r = b->records + k;
+  int *nodes;
+
+  if (s->ic->type) {
+    row = (const int *) listfile_array(s->ic, 2*sizeof(int));
+    assert(row != NULL);
+    id = row[0];
+    num_infected = row[1];
+  } else {
+    tokens_read = listfile_int(s->ic, &id) + listfile_int(s->ic, &num_infected);
+    assert(tokens_read == 2);
+  }
+  assert(num_infected > 0);
+  if (*used + 2L*num_infected > b->arena_capacity) {
+    while (*used + 2L*num_infected > b->arena_capacity)
+      b->arena_capacity = b->arena_capacity? 2*b->arena_capacity : 4096;
+    b->arena = (int *) realloc(b->arena, b->arena_capacity * sizeof(int));
+    assert(b->arena != NULL);
+  }
+  nodes = b->arena + *used;
+  if (s->ic->type) { // node, time pairs
+    row = (const int *) listfile_array(s->ic, 2L*num_infected*sizeof(int));
+    assert(row != NULL);
+    for (j = 0; j < num_infected; j++) {
+      nodes[j]              = row[2*j];
+      nodes[num_infected+j] = row[2*j+1];
+    }
+  } else
+    for (j = 0; j < num_infected; j++) {
+      tokens_read = listfile_node(s->ic, nodes+j, nodes+num_infected+j);
+      assert(tokens_read == 2 || (tokens_read == 1 && !s->times));
+    }
+  r->id = id;
+  r->num_infected = num_infected;
+  r->bound = 0;
+  b->offsets[k] = *used;
+  *used += 2L*num_infected;
+
+  if (s->bounds) {
+    if (s->bounds->type) {
+      row = (const int *) listfile_array(s->bounds, 2*sizeof(int));
+      assert(row != NULL);
+      id = row[0];
+      r->bound = row[1];
+    } else {
+      tokens_read = listfile_int(s->bounds, &id) + listfile_int(s->bounds, &r->bound);
+      assert(tokens_read == 2);
+    }
+    assert(id == r->id);
+  }
+}
+
+static void icstream_fill(ICStream *s, ICBatch *b) {
+  int k;
+  long used = 0;
+  b->first = s->produced;
+  for (b->count = 0; b->count < s->batch_size && s->produced < s->epidemics; b->count++) {
+    icstream_record(s, b, b->count, &used);
+    s->produced++;
+  }
+  for (k = 0; k < b->count; k++) {
+    b->records[k].infected  = b->arena + b->offsets[k];
+    b->records[k].infectedt = b->records[k].infected + b->records[k].num_infected;
+  }
+}
+
+static void *icstream_thread(void *arg) {
+  ICStream *s = (ICStream *) arg;
+  ICBatch *b;
+
+  for (;;) {
+    pthread_mutex_lock(&s->mutex);
+    while (!s->free_batches && !s->stop && s->produced < s->epidemics)
+      pthread_cond_wait(&s->released, &s->mutex);
+    if (s->stop || s->produced == s->epidemics)
+      break;
+    b = s->free_batches;
+    s->free_batches = b->next;
+    pthread_mutex_unlock(&s->mutex);
+
+    icstream_fill(s, b); // the list is only read here
+
+    pthread_mutex_lock(&s->mutex);
+    b->next = NULL;
+    if (s->tail)
+      s->tail->next = b;
+    else
+      s->head = b;
+    s->tail = b;
+    pthread_cond_signal(&s->filled);
+    pthread_mutex_unlock(&s->mutex);
+  }
+  s->done = 1;
+  pthread_cond_broadcast(&s->filled);
+  pthread_mutex_unlock(&s->mutex);
+  if (s->produced == s->epidemics) {
+    listfile_close(s->ic, "initial conditions");
+    if (s->bounds)
+      listfile_close(s->bounds, "bounds");
+  } else {
+    listfile_close(s->ic, NULL);
+    if (s->bounds)
+      listfile_close(s->bounds, NULL);
+  }
+  s->ic = s->bounds = NULL;
+  return NULL;
+}
+
+ICStream *icstream_open(FILE *ic_input, FILE *bounds_input, int batch_size,
+			int num_batches, int times) {
+  int i, tokens_read;
+  ICStream *s = (ICStream *) calloc(1, sizeof(ICStream));
+  assert(s != NULL);
+  assert(ic_input != NULL);
+  assert(batch_size > 0 && num_batches > 0);
+  s->batch_size  = batch_size;
+  s->num_batches = num_batches;
+  s->times       = times;
+
+  s->ic = listfile_open(ic_input);
+  if (s->ic->type) {
+    assert(s->ic->type == LIST_EPIDEMICS);
+    s->epidemics = (int) s->ic->rows;
+  } else {
+    tokens_read = listfile_int(s->ic, &s->epidemics);
+    assert(tokens_read == 1);
+  }
+  assert(s->epidemics > 0);
+  if (bounds_input) {
+    s->bounds = listfile_open(bounds_input);
+    assert(!s->bounds->type ||
+	   (s->bounds->type == LIST_BOUNDS && s->bounds->rows >= s->epidemics));
+  }
+
+  s->pool = (ICBatch *) calloc(num_batches, sizeof(ICBatch));
+  assert(s->pool != NULL);
+  for (i = 0; i < num_batches; i++) {
+    s->pool[i].records = (ICRecord *) calloc(batch_size, sizeof(ICRecord));
+    s->pool[i].offsets = (long *) calloc(batch_size, sizeof(long));
+    assert(s->pool[i].records != NULL && s->pool[i].offsets != NULL);
+    s->pool[i].next = (i+1 < num_batches)? s->pool+i+1 : NULL;
+  }
+  s->free_batches = s->pool;
+  pthread_mutex_init(&s->mutex, NULL);
+  pthread_cond_init(&s->filled, NULL);
+  pthread_cond_init(&s->released, NULL);
+  i = pthread_create(&s->thread, NULL, icstream_thread, s);
+  assert(i == 0);
+  return s;
+}
+
+ICBatch *icstream_next(ICStream *s) {
+  ICBatch *b;
+  pthread_mutex_lock(&s->mutex);
+  while (!s->head && !s->done)
+    pthread_cond_wait(&s->filled, &s->mutex);
+  b = s->head;
+  if (b) {
+    s->head = b->next;
+    if (!s->head)
+      s->tail = NULL;
+  }
+  pthread_mutex_unlock(&s->mutex);
+  return b;
+}
+
+void icstream_release(ICStream *s, ICBatch *b) {
+  assert(b != NULL);
+  pthread_mutex_lock(&s->mutex);
+  b->next = s->free_batches;
+  s->free_batches = b;
+  pthread_cond_signal(&s->released);
+  pthread_mutex_unlock(&s->mutex);
+}
+
+void icstream_close(ICStream *s) {
+  int i;
+  assert(s != NULL);
+  pthread_mutex_lock(&s->mutex);
+  s->stop = 1;
+  pthread_cond_signal(&s->released);
+  pthread_mutex_unlock(&s->mutex);
+  pthread_join(s->thread, NULL);
+  for (i = 0; i < s->num_batches; i++) {
+    free(s->pool[i].records);
+    free(s->pool[i].offsets);
+    free(s->pool[i].arena);
+  }
+  free(s->pool);
+  pthread_mutex_destroy(&s->mutex);
+  pthread_cond_destroy(&s->filled);
+  pthread_cond_destroy(&s->released);
+  free(s);
+}
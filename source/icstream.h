@@ -0,0 +1,83 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Header: streamed list of initial conditions. A producer thread parses
+  the list (text or binary, see listfile.h), and the list of bounds along
+  with it, into a fixed pool of batches; the simulation takes the batches
+  as they are filled and gives them back once its epidemics are done, so
+  that it starts at once and the memory is that of the pool, whatever
+  the number of epidemics.
+*/
+#ifndef ICSTREAM_H
+#define ICSTREAM_H
+#include <stdio.h>
+#include <pthread.h>
+#include "listfile.h"
+
+#define ICSTREAM_BATCH 1024      // default epidemics per batch
+
+typedef struct _ICRecord {
+  int id;                  // epidemic id
+  int num_infected;
+  int *infected;           // nodes, in the arena of the batch
+  int *infectedt;          // their infection times
+  int bound;               // from the list of bounds, 0 without it
+} ICRecord;
+
+typedef struct _ICBatch {
+  ICRecord *records;
+  int count;
+  long first;              // position of the first record in the list
+  int *arena;              // nodes and times of the records
+  long arena_capacity;
+  long *offsets;           // of the records in the arena, while filling
+  struct _ICBatch *next;
+} ICBatch;
+
+typedef struct _ICStream {
+  ListFile *ic, *bounds;
+  int epidemics;           // in the list
+  int batch_size;
+  int times;               // each node must come with its time
+  long produced;
+  ICBatch *pool;
+  int num_batches;
+  ICBatch *free_batches;   // to be filled
+  ICBatch *head, *tail;    // filled, in list order
+  int done, stop;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t filled, released;
+} ICStream;
+
+/**
+   Starts the producer on the list 'ic_input' and, unless NULL, the list
+   of bounds 'bounds_input' (same ids, same order); 'times' requires the
+   time of each infected node in text lists. The streams may be closed
+   once open.
+*/
+ICStream *icstream_open(FILE *ic_input, FILE *bounds_input, int batch_size,
+			int num_batches, int times);
+
+/**
+   Next filled batch, waiting for the producer; NULL at the end of the
+   list. May be called from several threads.
+*/
+ICBatch *icstream_next(ICStream *s);
+
+/**
+   Gives a batch back to the producer: its records are no longer valid
+*/
+void icstream_release(ICStream *s, ICBatch *b);
+
+/**
+   Stops the producer (the rest of the list is not read) and frees the pool
+*/
+void icstream_close(ICStream *s);
+
+#endif
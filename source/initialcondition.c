@@ -1,29 +1,39 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "initialcondition.h"
+#include "listfile.h"
 
 /**
-   Allocates a set of n infected nodes' id
+   Allocates the infected nodes and their activation times of the
+   'epidemics' epidemics, of known num_infected, in one arena: a flat CSR
+   whose rows are the epidemics in order (all the nodes, then all the
+   times), released at once by ic_free
 */
-inline void ic_init(InitialCondition *ic, int n) {
-  ic->num_infected = n;
-  ic->infected = (int *) calloc(n, sizeof(int));
-  assert(ic->infected != NULL);
-  ic->infectedt= (int *) calloc(n, sizeof(int));
-  assert(ic->infectedt != NULL);
+void ic_arena(InitialCondition *ic, int epidemics) {
+  int i;
+  long total = 0;
+  int *arena;
+  for (i = 0; i < epidemics; i++)
+    total += ic[i].num_infected;
+  assert(total > 0);
+  arena = (int *) calloc(2*total, sizeof(int));
+  assert(arena != NULL);
+  for (i = 0; i < epidemics; i++) {
+    ic[i].infected  = arena;
+    ic[i].infectedt = arena + total;
+    arena += ic[i].num_infected;
+  }
 }
 
 /**
-   De-allocates a set of n infected nodes' id
+   Releases an array of initial conditions and its arena
 */
-void ic_clean(InitialCondition *ic) {
-  if(ic) {
+void ic_free(InitialCondition *ic) {
+  if (ic) {
     free(ic->infected);
-    free(ic->infectedt);
-    ic->infected = NULL;
-    ic->infectedt= NULL;
-    ic->num_infected = 0;
+    free(ic);
   }
 }
 
@@ -33,7 +43,8 @@ void ic_clean(InitialCondition *ic) {
 inline InitialCondition *ic_trivial() {
   InitialCondition *ic = (InitialCondition *) calloc(1,sizeof(InitialCondition));
   assert(ic != NULL);
-  ic_init(ic, 1);
+  ic->num_infected = 1;
+  ic_arena(ic, 1);
   ic->infected[0] = 0;
   return ic;
 }
@@ -46,8 +57,10 @@ InitialCondition *ic_random_epidemics(int epidemics, int total_nodes) {
   InitialCondition *ic = (InitialCondition *) calloc(epidemics, sizeof(InitialCondition));
   assert(ic != NULL);
 
+  for (i = 0; i < epidemics; i++)
+    (ic+i)->num_infected = 1;
+  ic_arena(ic, epidemics);
   for (i = 0; i < epidemics; i++) {
-    ic_init(ic+i, 1);
     (ic+i)->id = i;
     (ic+i)->infected[0] = rand() % total_nodes;
   }
@@ -90,88 +103,194 @@ void ic_infect_randomly(InitialCondition *ic, int total_nodes) {
    <number of epidemics>
    <epidemic id> <number of infected nodes N> [<node 1> ... <node N>]
    ...
+   or its binary form (see listfile.h)
 */
 int ic_import(InitialCondition **ic, FILE *input, int total_nodes) {
   int i, j, id, num_infected, tokens_read, epidemics = 0;
-  assert(input != NULL);
-  tokens_read = fscanf(input, "%d\n", &epidemics);
-  assert(tokens_read == 1);
-  assert(epidemics > 0);
+  long n = 0, capacity = 0, start;
+  int *nodes = NULL, *times = NULL;
+  const int *row;
+  ListFile *lf = listfile_open(input);
   assert(ic != NULL);
+  if (lf->type) {
+    assert(lf->type == LIST_EPIDEMICS);
+    epidemics = (int) lf->rows;
+  } else {
+    tokens_read = listfile_int(lf, &epidemics);
+    assert(tokens_read == 1);
+  }
+  assert(epidemics > 0);
   *ic = (InitialCondition *) calloc(epidemics, sizeof(InitialCondition));
   assert(*ic != NULL);
 
-  for (i = 0; i < epidemics; i++) {
-    tokens_read = fscanf(input, "%d %d", &id, &num_infected);
-    assert(tokens_read == 2 && num_infected > 0);
-    ic_init(*ic+i, num_infected);
-    (*ic+i)->id = id;
-    if(total_nodes)
-      ic_infect_randomly(*ic+i, total_nodes);
-    else
-      for (j = 0; j < num_infected; j++) {
-        tokens_read = fscanf(input, "%d,%d",&(*ic+i)->infected[j],
-			     &(*ic+i)->infectedt[j]);
-        assert(tokens_read == 2);
+  if (lf->type) { // sizes first, then the node, time pairs into the arena
+    start = lf->pos;
+    for (i = 0; i < epidemics; i++) {
+      row = (const int *) listfile_array(lf, 2*sizeof(int));
+      assert(row != NULL && row[1] > 0);
+      (*ic+i)->id = row[0];
+      (*ic+i)->num_infected = row[1];
+      row = (const int *) listfile_array(lf, 2L*row[1]*sizeof(int));
+      assert(row != NULL);
+    }
+    ic_arena(*ic, epidemics);
+    lf->pos = start;
+    for (i = 0; i < epidemics; i++) {
+      row = (const int *) listfile_array(lf, (2L + 2L*(*ic+i)->num_infected)*sizeof(int)) + 2;
+      for (j = 0; j < (*ic+i)->num_infected; j++) {
+	(*ic+i)->infected[j]  = row[2*j];
+	(*ic+i)->infectedt[j] = row[2*j+1];
+      }
+    }
+  } else { // text: the nodes are gathered, then copied into the arena
+    for (i = 0; i < epidemics; i++) {
+      tokens_read = listfile_int(lf, &id) + listfile_int(lf, &num_infected);
+      assert(tokens_read == 2);
+      assert(num_infected > 0);
+      (*ic+i)->id = id;
+      (*ic+i)->num_infected = num_infected;
+      if (total_nodes)
+	continue;
+      if (n + num_infected > capacity) {
+	while (n + num_infected > capacity)
+	  capacity = capacity? 2*capacity : 1024;
+	nodes = (int *) realloc(nodes, capacity*sizeof(int));
+	times = (int *) realloc(times, capacity*sizeof(int));
+	assert(nodes != NULL && times != NULL);
+      }
+      for (j = 0; j < num_infected; j++, n++) {
+	tokens_read = listfile_node(lf, nodes+n, times+n);
+	assert(tokens_read == 2);
       }
+    }
+    ic_arena(*ic, epidemics);
+    if (n > 0) {
+      memcpy((*ic)->infected,  nodes, n*sizeof(int));
+      memcpy((*ic)->infectedt, times, n*sizeof(int));
+    }
+    free(nodes);
+    free(times);
   }
+  if (total_nodes)
+    for (i = 0; i < epidemics; i++)
+      ic_infect_randomly(*ic+i, total_nodes);
+  listfile_close(lf, "initial conditions");
   return epidemics;
 }
 
 /**
    Import stop bounds for each epidemic in the array *ic from file
-   composed of a collection of lines with: <id> <bound>
+   composed of a collection of lines with: <id> <bound> (or its binary
+   form)
 */
 void ic_import_bounds(InitialCondition *ic, int n, FILE *input) {
   int i, id, bound, tokens_read;
+  const int *rows = NULL;
+  ListFile *lf;
   assert(n > 0);
   assert(ic != NULL);
   assert(input != NULL);
-  
+  lf = listfile_open(input);
+  if (lf->type) {
+    assert(lf->type == LIST_BOUNDS && lf->rows >= n);
+    rows = (const int *) listfile_array(lf, 2L*n*sizeof(int));
+    assert(rows != NULL);
+  }
+
   for (i = 0; i < n; i++) {
-    tokens_read = fscanf(input, "%d %d\n", &id, &bound);
-    assert(tokens_read == 2);
+    if (rows) {
+      id    = rows[2*i];
+      bound = rows[2*i+1];
+    } else {
+      tokens_read = listfile_int(lf, &id) + listfile_int(lf, &bound);
+      assert(tokens_read == 2);
+    }
     assert(id == ic[i].id);
     assert(bound > 0);
     ic[i].bound = bound;
   }
+  listfile_close(lf, "bounds");
 }
 
 /**
-   Import vector of n doubles: <id> <double_val>
+   Import the rows <id> <double_val> (or their binary form) up to the end
+   of the list, or to the first row out of order
+*/
+double *import_drows(FILE *input, int *n) {
+  int id, tokens_read;
+  long capacity = 0;
+  const double *rows;
+  double *array = NULL;
+  ListFile *lf;
+  assert(input != NULL);
+  lf = listfile_open(input);
+  *n = 0;
+  if (lf->type) { // the ids are the positions
+    assert(lf->type == LIST_DOUBLES);
+    *n = (int) lf->rows;
+    rows = (const double *) listfile_array(lf, (long)*n*sizeof(double));
+    assert(rows != NULL);
+    array = (double *) malloc(((long)*n+1)*sizeof(double));
+    assert(array != NULL);
+    memcpy(array, rows, (long)*n*sizeof(double));
+  } else
+    for (;;) {
+      if (*n == capacity) {
+	capacity = capacity? 2*capacity : 1024;
+	array = (double *) realloc(array, capacity*sizeof(double));
+	assert(array != NULL);
+      }
+      tokens_read = listfile_int(lf, &id);
+      if (!tokens_read || id != *n)
+	break;
+      tokens_read = listfile_double(lf, array + *n);
+      if (!tokens_read)
+	break;
+      (*n)++;
+    }
+  listfile_close(lf, "activity rates");
+  return array;
+}
+
+/**
+   Import vector of n doubles: <id> <double_val> (or its binary form)
 */
 double *import_dlist(int n, FILE *input) {
-  int i, id, tokens_read;
-  double *array; 
+  int i, rows;
+  double *array;
   assert(n > 0);
-  assert(input != NULL);
-  array = (double *) calloc(n,sizeof(double));
-  assert(array != NULL);
-  
-  for (i = 0; i < n; i++) {
-    tokens_read = fscanf(input, "%d %lf\n", &id, &(array[i]));
-    assert(tokens_read == 2);
-    assert(id == i);
+  array = import_drows(input, &rows);
+  assert(rows >= n);
+  for (i = 0; i < n; i++)
     assert(array[i] >= 0.0);
-  }
   return array;
 }
 
 /**
-   Import vector of n ints: <id> <int_val>
+   Import vector of n ints: <id> <int_val> (or its binary form)
 */
 int *import_ilist(int n, FILE *input) {
-  int i, id, tokens_read, *array; 
+  int i, id, tokens_read, *array;
+  const int *rows;
+  ListFile *lf;
   assert(n > 0);
   assert(input != NULL);
   array = (int *) calloc(n,sizeof(int));
   assert(array != NULL);
-  
-  for (i = 0; i < n; i++) {
-    tokens_read = fscanf(input, "%d %d\n", &id, &(array[i]));
-    assert(tokens_read == 2);
-    assert(id == i);
+  lf = listfile_open(input);
+  if (lf->type) {
+    assert(lf->type == LIST_INTS && lf->rows >= n);
+    rows = (const int *) listfile_array(lf, (long)n*sizeof(int));
+    assert(rows != NULL);
+    memcpy(array, rows, (long)n*sizeof(int));
+  } else
+    for (i = 0; i < n; i++) {
+      tokens_read = listfile_int(lf, &id) + listfile_int(lf, array+i);
+      assert(tokens_read == 2);
+      assert(id == i);
+    }
+  for (i = 0; i < n; i++)
     assert(array[i] >= 0);
-  }
+  listfile_close(lf, NULL);
   return array;
 }
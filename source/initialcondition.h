@@ -24,14 +24,16 @@ typedef struct _InitialCondition {
 } InitialCondition;
 
 /**
-   Allocates a set of n infected nodes' id
+   Allocates the infected nodes and their activation times of the
+   'epidemics' epidemics, of known num_infected, in one arena (a flat CSR
+   indexed by epidemic)
 */
-inline void ic_init(InitialCondition *ic, int n);
+void ic_arena(InitialCondition *ic, int epidemics);
 
 /**
-   De-allocates a set of n infected nodes' id
+   Releases an array of initial conditions and its arena, in O(1)
 */
-void ic_clean(InitialCondition *ic);
+void ic_free(InitialCondition *ic);
 
 /**
    Returns the address of a new initial condition with one infected node (0)
@@ -71,6 +73,12 @@ void ic_import_bounds(InitialCondition *ic, int n, FILE *input);
 */
 double *import_dlist(int n, FILE *input);
 
+/**
+   Import the rows <id> <double> of a list up to its end (or to the first
+   row out of order), when n is not known yet; their number is put in 'n'
+*/
+double *import_drows(FILE *input, int *n);
+
 /**
    Import vector of n ints: <id> <int_val>
 */
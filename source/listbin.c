@@ -0,0 +1,149 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  List converter: writes the binary form (see listfile.h) of a text list
+  of initial conditions, bounds, activity rates, integers or connections,
+  checked as the simulators check them, so that large lists load without
+  parsing
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include "listfile.h"
+
+/**
+   Text rows as int32 (or float64) values, 'columns' per row, the first
+   one being the position of the row if 'indexed' (then not written)
+*/
+static long listbin_rows(ListFile *lf, FILE *out, int type, int columns, int indexed) {
+  long rows = 0, capacity = 0, n = 0, k;
+  int i, x, width = (type == LIST_DOUBLES)? 8 : 4;
+  unsigned char *buf = NULL;
+  double d;
+
+  for (;;) {
+    if (n + columns*width > capacity) {
+      capacity = capacity? 2*capacity : 1 << 20;
+      buf = (unsigned char *) realloc(buf, capacity);
+      assert(buf != NULL);
+    }
+    if (!listfile_int(lf, &x))
+      break;
+    if (indexed && x != rows) {
+      fprintf(stderr, "Row %ld: id %d out of order.\n", rows, x);
+      exit(1);
+    }
+    if (!indexed) {
+      memcpy(buf + n, &x, 4);
+      n += 4;
+    }
+    for (i = 1; i < columns; i++) {
+      k = (type == LIST_DOUBLES)? listfile_double(lf, &d) : listfile_int(lf, &x);
+      if (!k || (type == LIST_DOUBLES? d < 0.0 : x < 0)) {
+	fprintf(stderr, "Row %ld: missing or negative value.\n", rows);
+	exit(1);
+      }
+      if (type == LIST_DOUBLES)
+	memcpy(buf + n, &d, 8);
+      else
+	memcpy(buf + n, &x, 4);
+      n += width;
+    }
+    if (type == LIST_CONNECTIONS && ((int *)(buf + n))[-2] > ((int *)(buf + n))[-1]) {
+      fprintf(stderr, "Row %ld: login after logout.\n", rows);
+      exit(1);
+    }
+    rows++;
+  }
+  listfile_header(out, type, rows);
+  fwrite(buf, 1, n, out);
+  free(buf);
+  return rows;
+}
+
+/**
+   Initial conditions: <number of epidemics>, then <id> <N> <node[,time]> ...
+*/
+static long listbin_epidemics(ListFile *lf, FILE *out) {
+  int i, j, epidemics, row[2];
+  if (!listfile_int(lf, &epidemics) || epidemics <= 0) {
+    fprintf(stderr, "Missing number of epidemics.\n");
+    exit(1);
+  }
+  listfile_header(out, LIST_EPIDEMICS, epidemics);
+  for (i = 0; i < epidemics; i++) {
+    if (!listfile_int(lf, row) || !listfile_int(lf, row+1) || row[1] <= 0) {
+      fprintf(stderr, "Epidemic %d: bad header.\n", i);
+      exit(1);
+    }
+    fwrite(row, sizeof(int), 2, out);
+    for (j = row[1]; j > 0; j--) {
+      if (!listfile_node(lf, row, row+1)) {
+	fprintf(stderr, "Epidemic %d: missing node.\n", i);
+	exit(1);
+      }
+      fwrite(row, sizeof(int), 2, out);
+    }
+  }
+  return epidemics;
+}
+
+int main(int argc, char **argv) {
+  int i, type = 0;
+  long rows;
+  FILE *in = stdin;
+  ListFile *lf;
+  char syntax[] = "\n\
+ Usage: listbin -t TYPE [LIST_PATH] > BINARY_LIST_PATH (default: standard input)\n\n\
+ Types:\n\t\
+ epidemics (initial conditions: <n>, then <id> <N> <node[,time]> ...)\n\t\
+ bounds (<id> <bound>)\n\t\
+ mu (<id> <double>)\n\t\
+ ints (<id> <int>)\n\t\
+ connections (<id> <login> <logout>)\n";
+
+  while ((i = getopt(argc, argv, "t:")) != -1)
+    switch (i) {
+    case 't':
+      if (!strcmp(optarg, "epidemics"))        type = LIST_EPIDEMICS;
+      else if (!strcmp(optarg, "bounds"))      type = LIST_BOUNDS;
+      else if (!strcmp(optarg, "mu"))          type = LIST_DOUBLES;
+      else if (!strcmp(optarg, "ints"))        type = LIST_INTS;
+      else if (!strcmp(optarg, "connections")) type = LIST_CONNECTIONS;
+      break;
+    case '?':
+      fputs(syntax, stderr);
+    default:
+      abort();
+    }
+  if (!type) {
+    fputs(syntax, stderr);
+    exit(1);
+  }
+  if (optind < argc)
+    in = fopen(argv[optind], "r");
+  assert(in != NULL);
+  lf = listfile_open(in);
+  if (lf->type) {
+    fprintf(stderr, "Already a binary list.\n");
+    exit(1);
+  }
+  if (type == LIST_EPIDEMICS)
+    rows = listbin_epidemics(lf, stdout);
+  else
+    rows = listbin_rows(lf, stdout, type, (type == LIST_CONNECTIONS)? 3 : 2,
+			type != LIST_BOUNDS);
+  listfile_close(lf, "list");
+  if (in != stdin)
+    fclose(in);
+  fflush(stdout);
+  fprintf(stderr, "%ld rows.\n", rows);
+  return 0;
+}
@@ -0,0 +1,154 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Source: memory mapped input lists
+*/
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "listfile.h"
+
+static double listfile_clock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+ListFile *listfile_open(FILE *f) {
+  struct stat st;
+  unsigned char *buf = NULL;
+  unsigned int x;
+  long offset, n = 0, capacity = 0;
+  void *data;
+  ListFile *lf = (ListFile *) calloc(1, sizeof(ListFile));
+  assert(lf != NULL && f != NULL);
+  lf->start = listfile_clock();
+  offset = ftell(f);
+  if (fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) && offset >= 0 &&
+      st.st_size > offset) {
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (data != MAP_FAILED) {
+      madvise(data, st.st_size, MADV_SEQUENTIAL);
+      lf->data   = (const unsigned char *) data;
+      lf->size   = st.st_size;
+      lf->pos    = offset;
+      lf->mapped = 1;
+    }
+  }
+  if (!lf->mapped) { // a pipe (or an empty file): read it all
+    do {
+      if (n == capacity) {
+	capacity = capacity? 2*capacity : 1 << 16;
+	buf = (unsigned char *) realloc(buf, capacity);
+	assert(buf != NULL);
+      }
+      n += fread(buf + n, 1, capacity - n, f);
+    } while (n == capacity);
+    lf->data = buf;
+    lf->size = n;
+  }
+  if (lf->size - lf->pos >= LIST_HEADER_SIZE &&
+      !memcmp(lf->data + lf->pos, LIST_MAGIC, 8)) {
+    assert(sizeof(int) == 4 && sizeof(double) == 8);
+    x = 1;
+    assert(*(unsigned char *) &x == 1); // the rows are used in place
+    memcpy(&x, lf->data + lf->pos + 8,  4);  lf->type = (int) x;
+    memcpy(&x, lf->data + lf->pos + 12, 4);  lf->rows = (long) x;
+    assert(lf->type >= LIST_DOUBLES && lf->type <= LIST_EPIDEMICS);
+    lf->pos += LIST_HEADER_SIZE;
+  }
+  return lf;
+}
+
+/**
+   Blanks are any control characters, as well as spaces
+*/
+static inline void listfile_blanks(ListFile *lf) {
+  while (lf->pos < lf->size && lf->data[lf->pos] <= ' ')
+    lf->pos++;
+}
+
+int listfile_int(ListFile *lf, int *x) {
+  unsigned long v = 0;
+  long start;
+  int neg;
+  listfile_blanks(lf);
+  neg = lf->pos < lf->size && lf->data[lf->pos] == '-';
+  lf->pos += neg;
+  start = lf->pos;
+  while (lf->pos < lf->size && (unsigned)(lf->data[lf->pos] - '0') < 10) {
+    v = 10*v + (lf->data[lf->pos++] - '0');
+    assert(v <= (unsigned long) INT_MAX + 1);
+  }
+  if (lf->pos == start)
+    return 0;
+  assert(neg || v <= INT_MAX);
+  *x = neg? (int)(0 - v) : (int) v;
+  return 1;
+}
+
+/**
+   Copies the token, which is not terminated in the mapping, for strtod
+*/
+int listfile_double(ListFile *lf, double *x) {
+  char token[64], *end;
+  int n = 0;
+  listfile_blanks(lf);
+  while (lf->pos < lf->size && lf->data[lf->pos] > ' ' && n < (int) sizeof(token)-1)
+    token[n++] = (char) lf->data[lf->pos++];
+  token[n] = '\0';
+  *x = strtod(token, &end);
+  return n > 0 && *end == '\0';
+}
+
+int listfile_node(ListFile *lf, int *node, int *t) {
+  if (!listfile_int(lf, node))
+    return 0;
+  *t = 0;
+  if (lf->pos < lf->size && lf->data[lf->pos] == ',') {
+    lf->pos++;
+    return listfile_int(lf, t)? 2 : 0;
+  }
+  return 1;
+}
+
+const void *listfile_array(ListFile *lf, long bytes) {
+  const void *p = lf->data + lf->pos;
+  if (bytes < 0 || lf->size - lf->pos < bytes)
+    return NULL;
+  lf->pos += bytes;
+  return p;
+}
+
+void listfile_header(FILE *out, int type, long rows) {
+  unsigned char header[LIST_HEADER_SIZE];
+  unsigned int x;
+  assert(rows >= 0 && rows <= UINT_MAX);
+  memcpy(header, LIST_MAGIC, 8);
+  x = (unsigned int) type;  memcpy(header+8,  &x, 4);
+  x = (unsigned int) rows;  memcpy(header+12, &x, 4);
+  fwrite(header, 1, LIST_HEADER_SIZE, out);
+}
+
+void listfile_close(ListFile *lf, const char *what) {
+  assert(lf != NULL);
+  if (what)
+    fprintf(stderr, "  Parsed %s (%s, %ld bytes) in %.3f s.\n", what,
+	    lf->type? "binary" : "text", lf->size, listfile_clock() - lf->start);
+  if (lf->mapped)
+    munmap((void *) lf->data, lf->size);
+  else
+    free((void *) lf->data);
+  free(lf);
+}
@@ -0,0 +1,74 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Header: input lists (initial conditions, bounds, activity rates,
+  connections), memory mapped and parsed in bulk, in text or in an
+  equivalent binary form (see listbin.c).
+
+  Binary form (native little endian, as the arrays are used in place): a
+  16 bytes header ("SIRLISTB", type, number of rows; 32 bits integers)
+  followed by the rows:
+    LIST_DOUBLES     one float64 per id (mu lists)
+    LIST_INTS        one int32 per id
+    LIST_BOUNDS      int32 pairs: epidemic id, bound
+    LIST_CONNECTIONS int32 pairs per node id: login, logout
+    LIST_EPIDEMICS   per epidemic: id, N, then N int32 pairs: node, time
+*/
+#ifndef LISTFILE_H
+#define LISTFILE_H
+#include <stdio.h>
+
+#define LIST_MAGIC       "SIRLISTB"
+#define LIST_HEADER_SIZE 16
+#define LIST_DOUBLES     1
+#define LIST_INTS        2
+#define LIST_BOUNDS      3
+#define LIST_CONNECTIONS 4
+#define LIST_EPIDEMICS   5
+
+typedef struct _ListFile {
+  const unsigned char *data; // whole input
+  long size, pos;
+  int mapped;              // mmap, or read into memory (pipes)
+  int type;                // binary list: type, 0 for text
+  long rows;               // binary list: number of rows
+  double start;            // wall clock at opening
+} ListFile;
+
+/**
+   Maps the rest of the stream 'f' (or reads it, if it cannot be mapped)
+   and detects the binary form
+*/
+ListFile *listfile_open(FILE *f);
+
+/**
+   Text lists: next integer, double or "node[,time]" token (time 0 when
+   absent); return the number of values read, 0 at the end or if the
+   token is not a number
+*/
+int listfile_int(ListFile *lf, int *x);
+int listfile_double(ListFile *lf, double *x);
+int listfile_node(ListFile *lf, int *node, int *t);
+
+/**
+   Binary lists: the next 'bytes' bytes of the rows, in place; NULL if
+   the list is truncated
+*/
+const void *listfile_array(ListFile *lf, long bytes);
+
+/**
+   Writes the header of a binary list
+*/
+void listfile_header(FILE *out, int type, long rows);
+
+/**
+   Releases the list; reports the parsing time of 'what' unless NULL
+*/
+void listfile_close(ListFile *lf, const char *what);
+
+#endif
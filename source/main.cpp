@@ -14,18 +14,26 @@
 #include <string.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <getopt.h>
+#include <pthread.h>
 
 #include <iostream>
 
 #include "randfuncs.h"
 #include "graph.h"
 #include "initialcondition.h"
+#include "icstream.h"
 #include "epidemic.hpp"
+#include "checkpoint.h"
+#include "tracefile.h"
+#include "tracestats.h"
+#include "results.h"
 
 // misc defs and utils
 #define VERBOSE 1
 #define MAX_PATH_LENGTH 4096
 #define EPSILON  0.00001
+#define CHECKPOINT_PERIOD 60 // default delay between checkpoints (seconds)
 
 // auxiliary functions
 inline char *tstamp() {
@@ -44,17 +52,134 @@ inline void techo(char *str) {
 void parse_params (int argc,char **argv,int *epidemics,int *sample_epidemics,
 		   FILE **ic_list_input,FILE **graph_input,char** conn_path,
 		   double *mu,FILE **mu_list_input,FILE **bounds_list_input,
-		   int *maxtime,char **trace_output_path,FILE **data_output,
-		   double *p);
+		   int *maxtime,char **trace_output_path,char **data_output_path,
+		   FILE **data_output,double *p,char **checkpoint_path,
+		   int *checkpoint_period,int *resume,int *snapshot_time,
+		   int *branches,int *trace_fmt,int *trace_level,
+		   double *sample_rate,int *step_events,
+		   char **stats_output_path,char **results_output_path);
+/**
+   Appends the row of results of an epidemic (or branch) that stopped at
+   time 'end_time'
+*/
+inline void add_result(ResultsWriter *rw, Epidemic *e, InitialCondition *ic, int sample,
+		       int branch, int seeds, int end_time, double started) {
+  ResultRow row;
+  row.id            = ic->id;
+  row.sample        = sample;
+  row.branch        = branch;
+  row.seeds         = seeds;
+  row.bound         = ic->bound;
+  row.size          = e->num_infected;
+  row.max_depth     = e->max_depth;
+  row.cascade_links = e->cascade_links;
+  row.end_time      = end_time;
+  row.wall_time     = results_clock() - started;
+  resultswriter_add(rw, &row);
+}
+
+/**
+   Inputs loaded concurrently at startup, each by its own thread; the list
+   of epidemics is streamed by its own producer (see icstream.h)
+*/
+typedef struct _StartupInputs {
+  FILE *graph_input;
+  Graph *g;
+  char *conn_path;
+  int *connections;        // login, logout pairs ...
+  int conn_rows;           // ... of so many nodes
+  int conn_error;          // thrown if the graph has more nodes
+  FILE *mu_list_input;
+  double *mulist;
+  int mu_rows;
+  double graph_time, conn_time, mu_time; // seconds
+} StartupInputs;
+
+void *startup_graph(void *arg) {
+  StartupInputs *in = (StartupInputs *) arg;
+  double started = results_clock();
+  in->g = graph_from_file(in->graph_input);
+  in->graph_time = results_clock() - started;
+  return NULL;
+}
+
+void *startup_connections(void *arg) {
+  StartupInputs *in = (StartupInputs *) arg;
+  double started = results_clock();
+  in->connections = import_connections(in->conn_path, &in->conn_rows, &in->conn_error);
+  in->conn_time = results_clock() - started;
+  return NULL;
+}
+
+void *startup_mu(void *arg) {
+  StartupInputs *in = (StartupInputs *) arg;
+  double started = results_clock();
+  in->mulist = import_drows(in->mu_list_input, &in->mu_rows);
+  in->mu_time = results_clock() - started;
+  return NULL;
+}
+
+/**
+   Next initial condition of the stream, in 'ic': its nodes are those of
+   the batch, which is given back once all its records have been taken
+*/
+inline InitialCondition *stream_ic(ICStream *stream, ICBatch **batch, int *k,
+				   InitialCondition *ic, int maxtime, double p, double *mu) {
+  ICRecord *r;
+  if (*batch && *k == (*batch)->count) {
+    icstream_release(stream, *batch);
+    *batch = NULL;
+  }
+  if (!*batch) {
+    *batch = icstream_next(stream);
+    assert(*batch != NULL);
+    *k = 0;
+  }
+  r = (*batch)->records + (*k)++;
+  ic->id           = r->id;
+  ic->num_infected = r->num_infected;
+  ic->infected     = r->infected;
+  ic->infectedt    = r->infectedt;
+  ic->bounds       = NULL;
+  ic->bound        = (maxtime > 0)? maxtime : r->bound;
+  ic->p            = p;
+  ic->mu           = mu;
+  assert(ic->bound > 0);
+  return ic;
+}
+
 /**
    Main
 */
 int main(int argc, char **argv) {
-  int i, j;
+  int i, j, b, t, seeds, first = 0;
+  unsigned int seed, branch_seed;
+  double started;                   // wall clock at the start of an epidemic
   Graph *g;
-  InitialCondition *ic;
+  InitialCondition *ic = NULL;      // all the epidemics (random ones) ...
+  ICStream *stream = NULL;          // ... or streamed from the list
+  StartupInputs inputs;             // loaded concurrently
+  pthread_t graph_thread, conn_thread, mu_thread;
+  ICBatch *batch = NULL;            // batch of the stream being run ...
+  int k = 0;                        // ... and its next record
+  InitialCondition streamed, *current;
+  Checkpoint checkpoint;
+  Checkpointer *checkpointer = NULL;
+  EpidemicSnapshot snapshot;
   FILE *epidemic_output   = NULL;
+  FILE *branch_output     = NULL;
+  TraceOutput *epidemic_stage  = NULL; // output threads of the traces
+  TraceOutput *branch_stage    = NULL;
+  TraceWriter *epidemic_writer = NULL;
+  TraceWriter *branch_writer   = NULL;
+  RequestSink *requests        = NULL;
+  TraceStats *stats            = NULL; // aggregate statistics
+  FILE *stats_output;
+  FILE *results_output         = NULL; // table of results per epidemic
+  ResultsTable *results        = NULL;
+  ResultsWriter *results_writer= NULL;
   char epidemic_output_path[MAX_PATH_LENGTH] = "";
+  double startup;                      // wall clock at the start of the loading
 
   // default parameters
   int maxtime             = 0;      // global maximum epidemic simulation time
@@ -68,49 +193,153 @@ int main(int argc, char **argv) {
   FILE *bounds_list_input = NULL;   // input for list of epidemic bounds
   FILE *mu_list_input     = NULL;   // input for list of avg. inter-event delay 
   FILE *data_output       = NULL;   // output for extra simulation info
+  char *data_output_path  = NULL;
   char *trace_output_path = NULL;   // output for trace (global)
   char *conn_path         = NULL;
+  char *checkpoint_path   = NULL;   // checkpoints of the batch progress
+  int checkpoint_period   = CHECKPOINT_PERIOD;
+  int resume              = 0;      // resume from the last checkpoint
+  int snapshot_time       = 0;      // branch the epidemics at this time ...
+  int branches            = 0;      // ... into this number of continuations
+  int trace_fmt           = TRACE_TEXT; // trace file format
+  int trace_level         = 0;      // compression level of the traces
+  double sample_rate      = 1.0;    // fraction of the epidemics traced
+  int step_events         = 0;      // events traced per time step (0: all)
+  char *stats_output_path = NULL;   // output for aggregate statistics
+  char *results_output_path = NULL; // output for the table of results
 
   // parameter parsing
   parse_params(argc,argv,&epidemics,&sample_epidemics,&ic_list_input,
 	       &graph_input,&conn_path,&mu,&mu_list_input,&bounds_list_input,
-	       &maxtime,&trace_output_path,&data_output,&p);
+	       &maxtime,&trace_output_path,&data_output_path,&data_output,&p,
+	       &checkpoint_path,&checkpoint_period,&resume,&snapshot_time,
+	       &branches,&trace_fmt,&trace_level,&sample_rate,&step_events,
+	       &stats_output_path,&results_output_path);
 
   assert(graph_input && conn_path);
   assert(mu_list_input || (mu > 0.0));
   assert(bounds_list_input || maxtime > 0);
+  assert(checkpoint_path || !resume);
+  assert(trace_fmt != TRACE_REQUESTS || (!checkpoint_path && !branches));
+  assert(trace_fmt != TRACE_REQUESTS || !trace_level);
+  assert(!stats_output_path || (!branches && !resume)); // counts of this run only
  
   // preliminaires
-  srand(rdtsc());  // (unsigned)time(NULL) // rdtsc in randfuncs.h
+  seed = (unsigned int) rdtsc();  // rdtsc in randfuncs.h
+  if (resume && checkpoint_load(checkpoint_path, &checkpoint)) {
+    fprintf(stderr,"Resuming after %d completed epidemics (last id: %d)...\n\n",
+	    checkpoint.completed, checkpoint.last_id);
+    seed  = checkpoint.seed; // same seed: same random initial conditions
+    first = checkpoint.completed;
+  } else if (resume)
+    fprintf(stderr,"No checkpoint in %s: starting from scratch...\n\n",
+	    checkpoint_path);
+  checkpoint_rng_init(seed);
 
-  // load underlying graph
-  fprintf(stderr,"%s\nLoading the graph...\n", tstamp());
+  // load the graph, the connection data, the activity rates and the list
+  // of epidemics concurrently: the startup takes about the slowest of them
+  startup = results_clock();
+  fprintf(stderr,"%s\nLoading the graph, connection data and lists...\n", tstamp());
   fflush(stderr);
-  g = graph_from_file(graph_input);
+  if (ic_list_input) { // parsed by batches along the simulation
+    stream = icstream_open(ic_list_input, bounds_list_input, ICSTREAM_BATCH, 4, 1);
+    epidemics = stream->epidemics;
+    fclose(ic_list_input);
+  }
+  memset(&inputs, 0, sizeof(inputs));
+  inputs.graph_input   = graph_input;
+  inputs.conn_path     = conn_path;
+  inputs.mu_list_input = mu_list_input;
+  i = pthread_create(&graph_thread, NULL, startup_graph, &inputs);
+  assert(i == 0);
+  i = pthread_create(&conn_thread, NULL, startup_connections, &inputs);
+  assert(i == 0);
+  if (mu_list_input) {
+    i = pthread_create(&mu_thread, NULL, startup_mu, &inputs);
+    assert(i == 0);
+  }
+  pthread_join(graph_thread, NULL);
+  pthread_join(conn_thread, NULL);
+  if (mu_list_input) {
+    pthread_join(mu_thread, NULL);
+    fclose(mu_list_input);
+  }
   if (graph_input != stdin)
     fclose(graph_input);
-  fprintf(stderr,"  Loaded graph with %d nodes, %d links.\n\n", g->n, g->m);
+  g = inputs.g;
+  fprintf(stderr,"  Loaded graph with %d nodes, %d links in %.3f s.\n", g->n, g->m,
+	  inputs.graph_time);
+  fprintf(stderr,"  Loaded connection data of %d nodes in %.3f s.\n", inputs.conn_rows,
+	  inputs.conn_time);
+  if (mu_list_input)
+    fprintf(stderr,"  Loaded activity rates of %d nodes in %.3f s.\n", inputs.mu_rows,
+	    inputs.mu_time);
+  fputc('\n', stderr);
   fflush(stderr);
 
   // set global epidemic_output /* simplified solution Jan/2012 */
   assert(sample_epidemics == 1); // watch this!
   if (trace_output_path && strlen(trace_output_path) > 0) {
-    sprintf(epidemic_output_path,"%s-%s.trace",trace_output_path,"maxtime");
-    epidemic_output = fopen(epidemic_output_path, "w");
+    sprintf(epidemic_output_path,"%s-%s.%s",trace_output_path,"maxtime",
+	    trace_extension(trace_fmt,trace_level > 0));
+    if (first > 0)
+      epidemic_output = checkpoint_reopen(epidemic_output_path,
+					  checkpoint.trace_offset);
+    else
+      epidemic_output = fopen(epidemic_output_path, "w");
     assert(epidemic_output != NULL);
+    if (trace_fmt == TRACE_REQUESTS) // written at the end, in time order
+      epidemic_writer = tracewriter_requests(requests = requests_new(epidemic_output));
+    else { // double buffered: one block filled while the other is written
+      epidemic_stage  = traceoutput_new(epidemic_output, trace_fmt, 4, 2,
+				       trace_level, first > 0);
+      traceoutput_index(epidemic_stage, traceindex_create(epidemic_output_path,
+							  checkpoint.trace_offset, first > 0));
+      epidemic_writer = tracewriter_new(epidemic_stage);
+    }
+    tracewriter_sample(epidemic_writer, sample_rate, step_events);
+    if (branches) { // continuations: t P C F B, with B the branch number
+      sprintf(epidemic_output_path,"%s-%s.%s",trace_output_path,"branches",
+	      trace_extension(trace_fmt,trace_level > 0));
+      long branch_offset = (first > 0)? checkpoint.branch_offset : -1;
+      if (branch_offset >= 0)
+	branch_output = checkpoint_reopen(epidemic_output_path, branch_offset);
+      else
+	branch_output = fopen(epidemic_output_path, "w");
+      assert(branch_output != NULL);
+      branch_stage  = traceoutput_new(branch_output, trace_fmt, 5, 2, trace_level,
+				      branch_offset >= 0);
+      traceoutput_index(branch_stage, traceindex_create(epidemic_output_path,
+							 branch_offset >= 0? branch_offset : 0,
+							 branch_offset >= 0));
+      branch_writer = tracewriter_new(branch_stage);
+      tracewriter_sample(branch_writer, sample_rate, step_events);
+    }
   }
-  Epidemic epidemic(g,epidemic_output);
-  fprintf(stderr,"%s\nLoading connection data from list...\n\n", tstamp());
-  fflush(stderr);
-  epidemic.readconnections(conn_path);
+  if (data_output_path) {
+    if (first > 0 && checkpoint.status_offset >= 0)
+      data_output = checkpoint_reopen(data_output_path, checkpoint.status_offset);
+    else
+      data_output = fopen(data_output_path, "w");
+    assert(data_output != NULL);
+  }
+  if (results_output_path) {
+    if (first > 0 && checkpoint.results_offset >= 0)
+      results_output = checkpoint_reopen(results_output_path, checkpoint.results_offset);
+    else
+      results_output = fopen(results_output_path, "w");
+    assert(results_output != NULL);
+    results = results_new(results_output, first > 0 && checkpoint.results_offset >= 0);
+    results_writer = resultswriter_new(results);
+  }
+  if (stats_output_path)
+    stats = tracestats_new();
+  Epidemic epidemic(g,epidemic_writer,stats);
+  epidemic.setconnections(inputs.connections, inputs.conn_rows, inputs.conn_error);
+  free(inputs.connections);
 
-  // load initial conditions for the epidemics
-  fprintf(stderr,"%s\nLoading list of epidemics...\n", tstamp());
-  fflush(stderr);
-  if (ic_list_input) {
-    epidemics = ic_import(&ic, ic_list_input, 0);
-    fclose(ic_list_input);
-  } else { // infect randomly 'epidemics' epidemics
+  // initial conditions for the epidemics
+  if (!stream) { // infect randomly 'epidemics' epidemics
     fprintf(stderr,"  %s %d %s\n","No list of initial conditions given; loading",
 	    epidemics,"epidemics with 1 randomly infected node...");
     ic = ic_random_epidemics(epidemics, g->n);
@@ -119,8 +348,10 @@ int main(int argc, char **argv) {
   // set epidemics' random inter event duration rate
   if (mu_list_input) {
     fprintf(stderr,"Setting activity rate for epidemics from list...\n");
-    mulist = import_dlist(g->n, mu_list_input);
-    fclose(mu_list_input);
+    mulist = inputs.mulist;
+    assert(inputs.mu_rows >= g->n);
+    for(i = 0; i < g->n; i++)
+      assert(mulist[i] >= 0.0);
   } else {
     fprintf(stderr,
 	    "Setting global activity rate for epidemics (mu=%f)...\n",mu);
@@ -129,7 +360,7 @@ int main(int argc, char **argv) {
     for(i = 0; i < g->n; i++)
       mulist[i] = mu;
   }
-  for(i = 0; i < epidemics; i++) 
+  for(i = 0; ic && i < epidemics; i++)
     ic[i].mu = mulist;
   fflush(stderr);
   
@@ -137,59 +368,155 @@ int main(int argc, char **argv) {
   if (bounds_list_input) {
     fprintf(stderr,"Setting bounds for epidemics from list...\n");
     fflush(stderr);
-    ic_import_bounds(ic, epidemics, bounds_list_input);
+    if (ic)
+      ic_import_bounds(ic, epidemics, bounds_list_input);
     fclose(bounds_list_input);
   } else {
     fprintf(stderr,"Setting global bound for epidemics (t=%d)...\n",maxtime);
     fflush(stderr);
-    for(i = 0; i < epidemics; i++)
+    for(i = 0; ic && i < epidemics; i++)
       ic[i].bound = maxtime;
   }
 
   fprintf(stderr,"Setting global infection probability (p=%f)...\n",p);
   fflush(stderr);
-  for(i = 0; i < epidemics; i++)
+  for(i = 0; ic && i < epidemics; i++)
     ic[i].p = p;
 
-  fprintf(stderr,"  Loaded %d epidemics.\n\n", epidemics);
+  fprintf(stderr,"  %s %d epidemics.\n", stream? "Streaming" : "Loaded", epidemics);
+  fprintf(stderr,"  Startup (graph and lists) took %.3f s.\n\n", results_clock() - startup);
   fflush(stderr);
 
-  for (j = 0; j < epidemics; j++) {
+  // skip the epidemics completed before the checkpoint
+  assert(first <= epidemics);
+  if (first > 0) {
+    for (j = 0; j < first; j++)
+      current = stream? stream_ic(stream, &batch, &k, &streamed, maxtime, p, mulist) : ic+j;
+    assert(current->id == checkpoint.last_id);
+    checkpoint_rng_restore(checkpoint.rng);
+  }
+  if (checkpoint_path)
+    checkpointer = checkpointer_new(checkpoint_path, checkpoint_period, seed,
+				    epidemic_output, data_output, results_output, branch_output);
+
+  for (j = first; j < epidemics; j++) {
+    current = stream? stream_ic(stream, &batch, &k, &streamed, maxtime, p, mulist) : ic+j;
     fprintf(stderr,"%s: running epidemic %d up to %s = %d ...\n",
-	    tstamp(), ic[j].id, "maxtime", ic[j].bound);
+	    tstamp(), current->id, "maxtime", current->bound);
     fflush(stderr);
     
     for (i = 1; i <= sample_epidemics; i++) {
-      epidemic.setup(ic+j);
+      started = results_clock();
+      epidemic.setup(current);
+      seeds = epidemic.num_infected;
       
       if (data_output) {
 	fprintf(data_output,
 		"Epidemic %d #%d: started with %d / %d ( %.2f%% ) infected nodes\n",
-		ic[j].id,i, epidemic.num_infected,
+		current->id,i, epidemic.num_infected,
 		g->n, 100.0*(float)epidemic.num_infected/(float)g->n);
 	fflush(data_output);
       }
 
-      epidemic.simulate();
+      if (branches) {
+	// shared prefix, run once up to the snapshot time
+	epidemic.start();
+	epidemic.run(snapshot_time);
+	epidemic.snapshot(&snapshot, snapshot_time);
+	if (data_output)
+	  fprintf(data_output,
+"Epidemic %d #%d: snapshot at t = %d with %d depth, %d / %d ( %.2f%% ) infected nodes and %d links\n",
+		  current->id,i,snapshot_time,epidemic.max_depth,epidemic.num_infected,
+		  g->n, 100.0*(float)epidemic.num_infected/(float)g->n,
+		  epidemic.cascade_links);
+
+	// continuations, each with its own random stream
+	branch_seed = (unsigned int) rand();
+	for (b = 1; b <= branches; b++) {
+	  epidemic.branch(&snapshot, b, branch_writer);
+	  srand(branch_seed + 2654435761u*(unsigned int)b);
+	  t = epidemic.run(current->bound);
+	  if (results_writer) // wall time: shared prefix included
+	    add_result(results_writer, &epidemic, current, i, b, seeds, t, started);
+	  if (data_output)
+	    fprintf(data_output,
+"Epidemic %d #%d.%d: stopped with %d depth, %d / %d ( %.2f%% ) infected nodes and %d links\n",
+		    current->id,i,b,epidemic.max_depth,epidemic.num_infected,
+		    g->n, 100.0*(float)epidemic.num_infected/(float)g->n,
+		    epidemic.cascade_links);
+	}
+	if (data_output)
+	  fflush(data_output);
+      } else {
+	t = epidemic.simulate();
+	if (results_writer)
+	  add_result(results_writer, &epidemic, current, i, 0, seeds, t, started);
+      }
+      if (stats)
+	tracestats_epidemic(stats, epidemic.num_infected);
       
-      if (epidemic_output)
-	fflush(epidemic_output);
       
-      if (data_output) {
+      if (data_output && !branches) {
 	fprintf(data_output, 
 "Epidemic %d #%d: stopped with %d depth, %d / %d ( %.2f%% ) infected nodes and %d links\n",
-		ic[j].id,i,epidemic.max_depth,epidemic.num_infected,
+		current->id,i,epidemic.max_depth,epidemic.num_infected,
 		g->n, 100.0*(float)epidemic.num_infected/(float)g->n,
       		  epidemic.cascade_links);
 	fflush(data_output);
       }
     }
-    ic_clean(ic+j);
+
+    if (checkpointer && (j == epidemics-1 || checkpointer_due(checkpointer))) {
+      if (epidemic_stage) { // the trace offset must cover epidemic j
+	tracewriter_flush(epidemic_writer);
+	traceoutput_sync(epidemic_stage);
+      }
+      if (branch_stage) { // and that of its branches
+	tracewriter_flush(branch_writer);
+	traceoutput_sync(branch_stage);
+      }
+      if (results_writer) // rows up to epidemic j
+	resultswriter_flush(results_writer);
+      checkpointer_post(checkpointer, j+1, current->id);
+    }
   }
+  if (checkpointer)
+    checkpointer_destroy(checkpointer);
+  if (stream)
+    icstream_close(stream);
   
   // close global epidemic_output /* simplified solution Jan/2012 */
-  if (epidemic_output)
+  if (epidemic_output) {
+    tracewriter_destroy(epidemic_writer);
+    if (epidemic_stage)
+      traceoutput_destroy(epidemic_stage);
+    if (requests) {
+      fprintf(stderr,"%s\nWriting %ld events as requests...\n", tstamp(),
+	      requests->num_events);
+      fprintf(stderr,"  Written %ld requests.\n", requests_write(requests));
+      requests_destroy(requests);
+    }
     fclose(epidemic_output);
+  }
+  if (branch_output) {
+    tracewriter_destroy(branch_writer);
+    traceoutput_destroy(branch_stage);
+    fclose(branch_output);
+  }
+
+  if (results) {
+    resultswriter_destroy(results_writer);
+    fprintf(stderr,"  Written %ld rows of results.\n", results->rows);
+    results_destroy(results);
+    fclose(results_output);
+  }
+  if (stats) {
+    stats_output = fopen(stats_output_path, "w");
+    assert(stats_output != NULL);
+    tracestats_write(stats, stats_output);
+    fclose(stats_output);
+    tracestats_destroy(stats);
+  }
 
   // clean up and exit
   if (data_output && data_output != stdout)
@@ -199,7 +526,7 @@ int main(int argc, char **argv) {
   fprintf(stderr,"%s\nDone.\n", tstamp());
   fflush(stderr);
   free_graph(g);
-  free(ic);
+  ic_free(ic);
   return 0;
 }
 
@@ -209,9 +536,17 @@ int main(int argc, char **argv) {
 void parse_params (int argc,char **argv,int *epidemics,int *sample_epidemics,
 		   FILE **ic_list_input,FILE **graph_input,char**conn_path,
 		   double *mu,FILE **mu_list_input,FILE **bounds_list_input,
-		   int *maxtime,char **trace_output_path,FILE **data_output,
-		   double *p) {
+		   int *maxtime,char **trace_output_path,char **data_output_path,
+		   FILE **data_output,double *p,char **checkpoint_path,
+		   int *checkpoint_period,int *resume,int *snapshot_time,
+		   int *branches,int *trace_fmt,int *trace_level,
+		   double *sample_rate,int *step_events,
+		   char **stats_output_path,char **results_output_path) {
   int i;
+  struct option long_options[] = {
+    {"resume", no_argument, NULL, 'R'},
+    {NULL, 0, NULL, 0}
+  };
   char syntax[] = "\n\
  General parameters (required):\n\t\
  -g GRAPH_PATH\n\t\
@@ -229,10 +564,24 @@ void parse_params (int argc,char **argv,int *epidemics,int *sample_epidemics,
  -s NUM_SAMPLE_EPIDEMICS (defaul: 1)\n\t\
  -e [STATUS_OUTPUT_PATH]\n\t\
  -o EPIDEMIC_DIR_OUTPUT\n\t\
- -p INFECTION_PROBABILITY (default=1.0)\n";
+ -f TRACE_FORMAT (text, binary or requests, default: text)\n\t\
+ -z[LEVEL] (deflate the traces by blocks, level 1-9, default: 6)\n\t\
+ -y SAMPLE_RATE (trace a fraction of the epidemics, chosen by id)\n\t\
+ -Y STEP_EVENTS (trace a sample of at most so many events per time step)\n\t\
+ -S STATS_OUTPUT_PATH (aggregate statistics, with or without trace)\n\t\
+ -E RESULTS_OUTPUT_PATH (binary table of results, one row per epidemic)\n\t\
+ -p INFECTION_PROBABILITY (default=1.0)\n\n\
+ Checkpoints (optional):\n\t\
+ -k CHECKPOINT_PATH\n\t\
+ -K CHECKPOINT_PERIOD (seconds, default: 60)\n\t\
+ --resume (skip the epidemics completed at the last checkpoint)\n\n\
+ Branching (optional):\n\t\
+ -T SNAPSHOT_TIME\n\t\
+ -n NUM_BRANCHES (continuations from the state at SNAPSHOT_TIME)\n";
 
   fprintf(stderr, "SIMPLE EPIDEMIC CASCADE SIMULATION:\n\n");
-  while ((i = getopt(argc, argv, "g:c:a:b:t:m:i:x:s:e::o:p:")) != -1)
+  while ((i = getopt_long(argc, argv, "g:c:a:b:t:m:i:x:s:e::o:f:z::y:Y:S:E:p:k:K:T:n:",
+			  long_options, NULL)) != -1)
     switch (i) {
     case 'g':
       *graph_input = fopen(optarg,"r");
@@ -275,19 +624,58 @@ void parse_params (int argc,char **argv,int *epidemics,int *sample_epidemics,
       assert(*sample_epidemics > 0);
       break;
     case 'e':
-      if (optarg) {
-	*data_output = fopen(optarg,"w");
-	assert(*data_output != NULL);
-      } else
+      if (optarg) // opened once it is known whether the run resumes
+	*data_output_path = optarg;
+      else
 	*data_output = stderr;
       break;
     case 'o':
       *trace_output_path = optarg;
       break;
+    case 'f':
+      *trace_fmt = trace_format(optarg);
+      assert(*trace_fmt >= 0);
+      break;
+    case 'z':
+      *trace_level = optarg? atoi(optarg) : TRACEZIP_LEVEL;
+      assert(*trace_level >= 1 && *trace_level <= 9);
+      break;
+    case 'y':
+      *sample_rate = atof(optarg);
+      assert(*sample_rate > 0.0 && *sample_rate <= 1.0);
+      break;
+    case 'Y':
+      *step_events = atoi(optarg);
+      assert(*step_events > 0);
+      break;
+    case 'S':
+      *stats_output_path = optarg;
+      break;
+    case 'E':
+      *results_output_path = optarg;
+      break;
     case 'p':
       *p = atof(optarg);
       assert(*p > EPSILON && *p <= 1.0);
       break;
+    case 'k':
+      *checkpoint_path = optarg;
+      break;
+    case 'K':
+      *checkpoint_period = atoi(optarg);
+      assert(*checkpoint_period >= 0);
+      break;
+    case 'R':
+      *resume = 1;
+      break;
+    case 'T':
+      *snapshot_time = atoi(optarg);
+      assert(*snapshot_time >= 0);
+      break;
+    case 'n':
+      *branches = atoi(optarg);
+      assert(*branches > 0);
+      break;
     case '?':
       fputs(syntax, stderr);
     default:
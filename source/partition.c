@@ -0,0 +1,114 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Parts of a graph, see partition.h
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "partition.h"
+
+GraphPart *partition_new(int part, int num_parts, int n, int owned, int ghosts, long arcs) {
+  GraphPart *gp = (GraphPart *) calloc(1, sizeof(GraphPart));
+  assert(gp != NULL && part >= 0 && part < num_parts && owned >= 0 && ghosts >= 0);
+  gp->part        = part;
+  gp->num_parts   = num_parts;
+  gp->n           = n;
+  gp->owned       = owned;
+  gp->ghosts      = ghosts;
+  gp->arcs        = arcs;
+  gp->ids         = (int *) malloc((owned + ghosts + 1) * sizeof(int));
+  gp->offsets     = (long *) malloc((owned + 1) * sizeof(long));
+  gp->targets     = (int *) malloc((arcs + 1) * sizeof(int));
+  gp->ghost_part  = (int *) malloc((ghosts + 1) * sizeof(int));
+  gp->ghost_index = (int *) malloc((ghosts + 1) * sizeof(int));
+  assert(gp->ids != NULL && gp->offsets != NULL && gp->targets != NULL);
+  assert(gp->ghost_part != NULL && gp->ghost_index != NULL);
+  gp->offsets[0] = 0;
+  return gp;
+}
+
+void partition_write(GraphPart *gp, FILE *out) {
+  int header[6] = {gp->part, gp->num_parts, gp->n, gp->owned, gp->ghosts, 0};
+  fwrite(PART_MAGIC, 1, 8, out);
+  fwrite(header, sizeof(int), 6, out);
+  fwrite(&gp->arcs, sizeof(long), 1, out);
+  fwrite(gp->ids, sizeof(int), gp->owned + gp->ghosts, out);
+  fwrite(gp->offsets, sizeof(long), gp->owned + 1, out);
+  fwrite(gp->targets, sizeof(int), gp->arcs, out);
+  fwrite(gp->ghost_part, sizeof(int), gp->ghosts, out);
+  fwrite(gp->ghost_index, sizeof(int), gp->ghosts, out);
+}
+
+static int partition_fields(FILE *in, int *header, long *arcs) {
+  char magic[8];
+  return fread(magic, 1, 8, in) == 8 && !memcmp(magic, PART_MAGIC, 8)
+    && fread(header, sizeof(int), 6, in) == 6 && fread(arcs, sizeof(long), 1, in) == 1
+    && header[1] > 0 && header[0] >= 0 && header[0] < header[1];
+}
+
+int partition_header(FILE *in, int *part, int *num_parts, int *n) {
+  int header[6];
+  long arcs;
+  if (!partition_fields(in, header, &arcs))
+    return 0;
+  *part      = header[0];
+  *num_parts = header[1];
+  *n         = header[2];
+  return 1;
+}
+
+GraphPart *partition_read(FILE *in) {
+  int header[6], ok;
+  long arcs;
+  GraphPart *gp;
+
+  if (!partition_fields(in, header, &arcs) || header[3] < 0 || header[4] < 0 || arcs < 0)
+    return NULL;
+  gp = partition_new(header[0], header[1], header[2], header[3], header[4], arcs);
+  ok = fread(gp->ids, sizeof(int), gp->owned + gp->ghosts, in) == (size_t)(gp->owned + gp->ghosts)
+    && fread(gp->offsets, sizeof(long), gp->owned + 1, in) == (size_t)(gp->owned + 1)
+    && fread(gp->targets, sizeof(int), arcs, in) == (size_t)arcs
+    && fread(gp->ghost_part, sizeof(int), gp->ghosts, in) == (size_t)gp->ghosts
+    && fread(gp->ghost_index, sizeof(int), gp->ghosts, in) == (size_t)gp->ghosts
+    && gp->offsets[gp->owned] == arcs;
+  if (!ok) {
+    partition_destroy(gp);
+    return NULL;
+  }
+  return gp;
+}
+
+int partition_local(GraphPart *gp, int id) {
+  int lo = 0, hi = gp->owned - 1, mid;
+  while (lo <= hi) { // the owned nodes are sorted by id
+    mid = lo + (hi - lo) / 2;
+    if (gp->ids[mid] < id)
+      lo = mid + 1;
+    else if (gp->ids[mid] > id)
+      hi = mid - 1;
+    else
+      return mid;
+  }
+  return -1;
+}
+
+char *partition_path(char *buf, const char *prefix, int part) {
+  sprintf(buf, "%s.part%d", prefix, part);
+  return buf;
+}
+
+void partition_destroy(GraphPart *gp) {
+  assert(gp != NULL);
+  free(gp->ids);
+  free(gp->offsets);
+  free(gp->targets);
+  free(gp->ghost_part);
+  free(gp->ghost_index);
+  free(gp);
+}
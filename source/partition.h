@@ -0,0 +1,68 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Header: parts of a graph too large for the memory of one process (see
+  graphpart.c), each loaded by one process of a distributed simulation.
+  A part owns a set of nodes, numbered locally 0..owned-1 in increasing
+  order of their ids in the graph, and holds their links only; the
+  neighbours owned by other parts are its ghosts, numbered locally from
+  'owned' on, each with the part that owns it and its local number there.
+
+  Binary form (native little endian): a 32 bytes header ("SIRPARTB",
+  part, number of parts, nodes of the graph, owned nodes, ghosts, 0; 32
+  bits integers), the number of arcs (64 bits), then the arrays
+    ids          int32 per local node: its id in the graph
+    offsets      int64 per owned node, plus one: CSR of the links
+    targets      int32 per arc: local number of the neighbour
+    ghost_part   int32 per ghost: the part that owns it
+    ghost_index  int32 per ghost: its local number in that part
+*/
+#ifndef PARTITION_H
+#define PARTITION_H
+#include <stdio.h>
+
+#define PART_MAGIC       "SIRPARTB"
+#define PART_HEADER_SIZE 32
+
+typedef struct _GraphPart {
+  int part, num_parts;
+  int n;                   // nodes of the whole graph
+  int owned, ghosts;       // local nodes: owned ones, then ghosts
+  long arcs;
+  int *ids;                // id in the graph of each local node
+  long *offsets;           // links of u: targets[offsets[u]..offsets[u+1])
+  int *targets;
+  int *ghost_part;         // of ghost owned + g: owner part ...
+  int *ghost_index;        // ... and local number there
+} GraphPart;
+
+/**
+   Empty part 'part' of 'num_parts', with room for its arrays
+*/
+GraphPart *partition_new(int part, int num_parts, int n, int owned, int ghosts, long arcs);
+void partition_write(GraphPart *gp, FILE *out);
+
+/**
+   Reads a part written by partition_write; NULL if it is malformed.
+   partition_header reads only the header, eg to know the number of parts
+*/
+GraphPart *partition_read(FILE *in);
+int partition_header(FILE *in, int *part, int *num_parts, int *n);
+
+/**
+   Local number of the node of id 'id' if the part owns it, -1 otherwise
+*/
+int partition_local(GraphPart *gp, int id);
+
+/**
+   Path of part 'part' of the graph 'prefix': PREFIX.partK
+*/
+char *partition_path(char *buf, const char *prefix, int part);
+void partition_destroy(GraphPart *gp);
+
+#endif
@@ -0,0 +1,146 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Source: P2P network file request format, generated in memory
+*/
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "requests.h"
+
+RequestSink *requests_new(FILE *out) {
+  RequestSink *rs = (RequestSink *) malloc(sizeof(RequestSink));
+  assert(rs != NULL);
+  rs->out        = out;
+  rs->runs       = NULL;
+  rs->num_runs   = 0;
+  rs->capacity   = 0;
+  rs->num_events = 0;
+  pthread_mutex_init(&rs->lock, NULL);
+  return rs;
+}
+
+static int cmp_client_provider(const void *a, const void *b) {
+  const int *x = (const int *) a, *y = (const int *) b;
+  if (x[2] != y[2])
+    return (x[2] < y[2])? -1 : 1;
+  return (x[1] < y[1])? -1 : (x[1] > y[1]);
+}
+
+static int cmp_time_client_provider(const void *a, const void *b) {
+  const int *x = (const int *) a, *y = (const int *) b;
+  if (x[0] != y[0])
+    return (x[0] < y[0])? -1 : 1;
+  return cmp_client_provider(a, b);
+}
+
+/**
+   Events come in nondecreasing time from both engines, so each time step
+   is sorted on its own; any other order falls back to a full sort
+*/
+static void requests_sort(int *events, int n) {
+  int i, first = 0;
+  for (i = 1; i < n; i++)
+    if (events[3*i] < events[3*(i-1)]) {
+      qsort(events, n, 3*sizeof(int), cmp_time_client_provider);
+      return;
+    }
+  for (i = 1; i <= n; i++)
+    if (i == n || events[3*i] != events[3*first]) {
+      if (i - first > 1)
+	qsort(events + 3*first, i - first, 3*sizeof(int), cmp_client_provider);
+      first = i;
+    }
+}
+
+void requests_add(RequestSink *rs, int id, int *events, int n) {
+  if (n == 0) {
+    free(events);
+    return;
+  }
+  requests_sort(events, n);
+  pthread_mutex_lock(&rs->lock);
+  if (rs->num_runs == rs->capacity) {
+    rs->capacity = rs->capacity? 2*rs->capacity : 64;
+    rs->runs = (RequestRun *) realloc(rs->runs, rs->capacity * sizeof(RequestRun));
+    assert(rs->runs != NULL);
+  }
+  rs->runs[rs->num_runs].id         = id;
+  rs->runs[rs->num_runs].num_events = n;
+  rs->runs[rs->num_runs].events     = events;
+  rs->num_runs++;
+  rs->num_events += n;
+  pthread_mutex_unlock(&rs->lock);
+}
+
+/**
+   Order of the current events of two runs: (t, C, F, P)
+*/
+static int requests_less(RequestSink *rs, int *pos, int a, int b) {
+  const int *x = rs->runs[a].events + 3*pos[a];
+  const int *y = rs->runs[b].events + 3*pos[b];
+  if (x[0] != y[0]) return x[0] < y[0];
+  if (x[2] != y[2]) return x[2] < y[2];
+  if (rs->runs[a].id != rs->runs[b].id) return rs->runs[a].id < rs->runs[b].id;
+  return x[1] < y[1];
+}
+
+static void requests_sift(RequestSink *rs, int *heap, int size, int *pos, int i) {
+  int child, tmp;
+  while ((child = 2*i+1) < size) {
+    if (child+1 < size && requests_less(rs, pos, heap[child+1], heap[child]))
+      child++;
+    if (!requests_less(rs, pos, heap[child], heap[i]))
+      break;
+    tmp = heap[i]; heap[i] = heap[child]; heap[child] = tmp;
+    i = child;
+  }
+}
+
+long requests_write(RequestSink *rs) {
+  int i, r, size = rs->num_runs, t = 0, c = 0, f = 0, *ev;
+  long lines = 0;
+  int *heap = (int *) malloc((size+1) * sizeof(int));
+  int *pos  = (int *) calloc(size+1, sizeof(int));
+  assert(heap != NULL && pos != NULL);
+
+  for (i = 0; i < size; i++)
+    heap[i] = i;
+  for (i = size/2-1; i >= 0; i--)
+    requests_sift(rs, heap, size, pos, i);
+  while (size > 0) {
+    r  = heap[0];
+    ev = rs->runs[r].events + 3*pos[r];
+    if (lines == 0 || ev[0] != t || ev[2] != c || rs->runs[r].id != f) {
+      if (lines > 0)
+	fputc('\n', rs->out);
+      fprintf(rs->out, "%d %d %d", t = ev[0], c = ev[2], f = rs->runs[r].id);
+      lines++;
+    }
+    fprintf(rs->out, " %d", ev[1]);
+    if (++pos[r] == rs->runs[r].num_events)
+      heap[0] = heap[--size];
+    requests_sift(rs, heap, size, pos, 0);
+  }
+  if (lines > 0)
+    fputc('\n', rs->out);
+  free(heap);
+  free(pos);
+  return lines;
+}
+
+void requests_destroy(RequestSink *rs) {
+  int i;
+  assert(rs != NULL);
+  for (i = 0; i < rs->num_runs; i++)
+    free(rs->runs[i].events);
+  free(rs->runs);
+  pthread_mutex_destroy(&rs->lock);
+  free(rs);
+}
@@ -0,0 +1,48 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Header: P2P network file request format (t C F P1 ... Pn), generated in
+  memory. Each epidemic hands its events as a run sorted by (t, C, P);
+  the runs are merged by (t, C, F, P) with a heap when the output is
+  written, so the lines come out as after the sort + awk of p2p-format.sh
+*/
+#ifndef REQUESTS_H
+#define REQUESTS_H
+#include <stdio.h>
+#include <pthread.h>
+
+typedef struct _RequestRun {
+  int id;                  // epidemic (file) id
+  int num_events;
+  int *events;             // t P C triples, sorted by (t, C, P)
+} RequestRun;
+
+typedef struct _RequestSink {
+  FILE *out;
+  RequestRun *runs;
+  int num_runs, capacity;
+  long num_events;
+  pthread_mutex_t lock;    // runs are added from several threads
+} RequestSink;
+
+RequestSink *requests_new(FILE *out);
+
+/**
+   Adds the 'n' events (t P C triples) of epidemic 'id'; the sink takes
+   ownership of 'events', which are sorted here, outside of the lock
+*/
+void requests_add(RequestSink *rs, int id, int *events, int n);
+
+/**
+   Merges the runs into the output as request lines; returns the number
+   of lines
+*/
+long requests_write(RequestSink *rs);
+void requests_destroy(RequestSink *rs);
+
+#endif
@@ -0,0 +1,222 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Source: columnar table of results
+*/
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "results.h"
+
+#define RESULTS_HEADER_SIZE (16 + 24*RESULTS_COLUMNS)
+#define RESULTS_PAD(n) (((n) + 7) & ~7L)
+
+static const struct {
+  const char *name;
+  int type;
+  size_t offset;           // in ResultRow
+} results_columns[RESULTS_COLUMNS] = {
+  {"id",            RESULTS_INT32,   offsetof(ResultRow, id)},
+  {"sample",        RESULTS_INT32,   offsetof(ResultRow, sample)},
+  {"branch",        RESULTS_INT32,   offsetof(ResultRow, branch)},
+  {"seeds",         RESULTS_INT32,   offsetof(ResultRow, seeds)},
+  {"bound",         RESULTS_INT32,   offsetof(ResultRow, bound)},
+  {"size",          RESULTS_INT32,   offsetof(ResultRow, size)},
+  {"max_depth",     RESULTS_INT32,   offsetof(ResultRow, max_depth)},
+  {"cascade_links", RESULTS_INT32,   offsetof(ResultRow, cascade_links)},
+  {"end_time",      RESULTS_INT32,   offsetof(ResultRow, end_time)},
+  {"wall_time",     RESULTS_FLOAT64, offsetof(ResultRow, wall_time)}
+};
+
+static int results_width(int type) {
+  return (type == RESULTS_FLOAT64)? 8 : 4;
+}
+
+/**
+   The columns are stored as the host lays them out in memory
+*/
+static void results_check_host() {
+  unsigned int one = 1;
+  assert(*(unsigned char *) &one == 1 && sizeof(int) == 4 && sizeof(double) == 8);
+}
+
+double results_clock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+ResultsTable *results_new(FILE *out, int append) {
+  unsigned char header[RESULTS_HEADER_SIZE];
+  unsigned int x;
+  int i;
+  ResultsTable *rt = (ResultsTable *) calloc(1, sizeof(ResultsTable));
+  assert(rt != NULL && out != NULL);
+  results_check_host();
+  rt->out = out;
+  pthread_mutex_init(&rt->lock, NULL);
+  if (append)
+    return rt;
+  memset(header, 0, sizeof(header));
+  memcpy(header, RESULTS_MAGIC, 8);
+  x = RESULTS_VERSION;  memcpy(header+8,  &x, 4);
+  x = RESULTS_COLUMNS;  memcpy(header+12, &x, 4);
+  for (i = 0; i < RESULTS_COLUMNS; i++) {
+    strncpy((char *) header + 16 + 24*i, results_columns[i].name, RESULTS_NAME_SIZE-1);
+    x = results_columns[i].type;
+    memcpy(header + 16 + 24*i + RESULTS_NAME_SIZE, &x, 4);
+  }
+  fwrite(header, 1, RESULTS_HEADER_SIZE, out);
+  return rt;
+}
+
+ResultsTable *results_callback(ResultsCallback callback, void *user) {
+  ResultsTable *rt = (ResultsTable *) calloc(1, sizeof(ResultsTable));
+  assert(rt != NULL && callback != NULL);
+  rt->callback = callback;
+  rt->user     = user;
+  pthread_mutex_init(&rt->lock, NULL);
+  return rt;
+}
+
+void results_destroy(ResultsTable *rt) {
+  assert(rt != NULL);
+  if (rt->out)
+    fflush(rt->out);
+  pthread_mutex_destroy(&rt->lock);
+  free(rt);
+}
+
+ResultsWriter *resultswriter_new(ResultsTable *rt) {
+  ResultsWriter *rw = (ResultsWriter *) calloc(1, sizeof(ResultsWriter));
+  assert(rw != NULL);
+  rw->table = rt;
+  rw->rows  = (ResultRow *) malloc(RESULTS_GROUP_ROWS * sizeof(ResultRow));
+  rw->buf   = (unsigned char *) malloc(8 + RESULTS_COLUMNS * RESULTS_PAD(8L*RESULTS_GROUP_ROWS));
+  assert(rw->rows != NULL && rw->buf != NULL);
+  return rw;
+}
+
+void resultswriter_add(ResultsWriter *rw, ResultRow *row) {
+  if (rw->table->callback) {
+    pthread_mutex_lock(&rw->table->lock);
+    rw->table->callback(rw->table->user, row);
+    rw->table->rows++;
+    pthread_mutex_unlock(&rw->table->lock);
+    return;
+  }
+  rw->rows[rw->count++] = *row;
+  if (rw->count == RESULTS_GROUP_ROWS)
+    resultswriter_flush(rw);
+}
+
+/**
+   Lays the group out by columns outside the lock, then appends it with a
+   single write
+*/
+void resultswriter_flush(ResultsWriter *rw) {
+  unsigned int n = (unsigned int) rw->count;
+  long len = 8;
+  int i, k, w;
+  if (n == 0)
+    return;
+  memcpy(rw->buf, RESULTS_GROUP_TAG, 4);
+  memcpy(rw->buf+4, &n, 4);
+  for (k = 0; k < RESULTS_COLUMNS; k++) {
+    w = results_width(results_columns[k].type);
+    for (i = 0; i < rw->count; i++)
+      memcpy(rw->buf + len + (long)i*w, (char *)(rw->rows+i) + results_columns[k].offset, w);
+    memset(rw->buf + len + (long)n*w, 0, RESULTS_PAD((long)n*w) - (long)n*w);
+    len += RESULTS_PAD((long)n*w);
+  }
+  pthread_mutex_lock(&rw->table->lock);
+  fwrite(rw->buf, 1, len, rw->table->out);
+  rw->table->rows += n;
+  pthread_mutex_unlock(&rw->table->lock);
+  rw->count = 0;
+}
+
+void resultswriter_destroy(ResultsWriter *rw) {
+  assert(rw != NULL);
+  resultswriter_flush(rw);
+  free(rw->rows);
+  free(rw->buf);
+  free(rw);
+}
+
+ResultsFile *results_map(const char *path) {
+  struct stat st;
+  unsigned int version, columns, type;
+  int i, fd = open(path, O_RDONLY);
+  ResultsFile *rf;
+  void *data;
+
+  results_check_host();
+  if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < 16) {
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return NULL;
+  rf = (ResultsFile *) calloc(1, sizeof(ResultsFile));
+  assert(rf != NULL);
+  rf->data = (unsigned char *) data;
+  rf->size = st.st_size;
+  memcpy(&version, rf->data+8,  4);
+  memcpy(&columns, rf->data+12, 4);
+  if (memcmp(rf->data, RESULTS_MAGIC, 8) || version != RESULTS_VERSION ||
+      columns == 0 || columns > RESULTS_COLUMNS || rf->size < 16 + 24*(long)columns) {
+    results_unmap(rf);
+    return NULL;
+  }
+  rf->num_columns = (int) columns;
+  for (i = 0; i < rf->num_columns; i++) {
+    memcpy(rf->names[i], rf->data + 16 + 24*i, RESULTS_NAME_SIZE);
+    rf->names[i][RESULTS_NAME_SIZE-1] = '\0';
+    memcpy(&type, rf->data + 16 + 24*i + RESULTS_NAME_SIZE, 4);
+    rf->types[i] = (int) type;
+  }
+  rf->pos = 16 + 24*(long)columns;
+  return rf;
+}
+
+int results_next(ResultsFile *rf, ResultsGroup *g) {
+  unsigned int n;
+  long len = 8;
+  int k;
+  if (rf->pos + 8 > rf->size || memcmp(rf->data + rf->pos, RESULTS_GROUP_TAG, 4))
+    return 0;
+  memcpy(&n, rf->data + rf->pos + 4, 4);
+  for (k = 0; k < rf->num_columns; k++) {
+    g->columns[k] = rf->data + rf->pos + len;
+    len += RESULTS_PAD((long)n * results_width(rf->types[k]));
+  }
+  if (rf->pos + len > rf->size) {
+    fprintf(stderr, "Truncated row group.\n");
+    return 0;
+  }
+  g->rows = (int) n;
+  rf->pos += len;
+  return 1;
+}
+
+void results_unmap(ResultsFile *rf) {
+  assert(rf != NULL);
+  munmap(rf->data, rf->size);
+  free(rf);
+}
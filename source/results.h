@@ -0,0 +1,120 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Header: columnar table of results, one row per epidemic and sample (and
+  branch), shared by simplesir and scascade.
+
+  Format (native little endian, to be memory mapped): a header ("SIRRESLT",
+  version, number of columns; then per column a name of 16 bytes, a type
+  and 4 reserved bytes; 32 bits integers) followed by row groups. A group
+  is "RGRP", its number of rows, then each column as a plain array of
+  int32 or float64, padded to a multiple of 8 bytes. Each thread fills its
+  own group and appends it as a whole, so the groups of several threads
+  interleave and the rows are not sorted.
+*/
+#ifndef RESULTS_H
+#define RESULTS_H
+#include <stdio.h>
+#include <pthread.h>
+
+#define RESULTS_MAGIC      "SIRRESLT"
+#define RESULTS_GROUP_TAG  "RGRP"
+#define RESULTS_VERSION    1
+#define RESULTS_INT32      1
+#define RESULTS_FLOAT64    2
+#define RESULTS_NAME_SIZE  16
+#define RESULTS_COLUMNS    10
+#define RESULTS_GROUP_ROWS 4096
+
+typedef struct _ResultRow {
+  int id;                  // epidemic id
+  int sample;
+  int branch;              // 0: not a branch
+  int seeds;               // initially infected nodes
+  int bound;
+  int size;                // final number of infected nodes
+  int max_depth;
+  int cascade_links;
+  int end_time;            // time of the last event
+  double wall_time;        // seconds
+} ResultRow;
+
+/**
+   Receiver of the rows of a table (eg, of an embedding program, see
+   scascade.h)
+*/
+typedef void (*ResultsCallback)(void *user, const ResultRow *row);
+
+typedef struct _ResultsTable {
+  FILE *out;
+  ResultsCallback callback; // or each row to callback(user, row), as added
+  void *user;
+  long rows;               // rows written
+  pthread_mutex_t lock;    // groups appended from several threads
+} ResultsTable;
+
+typedef struct _ResultsWriter {
+  ResultsTable *table;
+  ResultRow *rows;         // current group
+  int count;
+  unsigned char *buf;      // group laid out by columns
+} ResultsWriter;
+
+typedef struct _ResultsFile {
+  unsigned char *data;     // mapped file
+  long size;
+  int num_columns;
+  char names[RESULTS_COLUMNS][RESULTS_NAME_SIZE];
+  int types[RESULTS_COLUMNS];
+  long pos;                // next group
+} ResultsFile;
+
+typedef struct _ResultsGroup {
+  int rows;
+  const void *columns[RESULTS_COLUMNS]; // int * or double *, by type
+} ResultsGroup;
+
+/**
+   Wall clock, in seconds
+*/
+double results_clock();
+
+/**
+   Starts a table on 'out'; the header is written unless the table is
+   resumed ('append')
+*/
+ResultsTable *results_new(FILE *out, int append);
+
+/**
+   Table whose rows are handed to 'callback', under its lock, instead of
+   being written
+*/
+ResultsTable *results_callback(ResultsCallback callback, void *user);
+void results_destroy(ResultsTable *rt);
+
+/**
+   Writer of one thread: rows are appended by groups, on 'flush' or when
+   a group is full
+*/
+ResultsWriter *resultswriter_new(ResultsTable *rt);
+void resultswriter_add(ResultsWriter *rw, ResultRow *row);
+void resultswriter_flush(ResultsWriter *rw);
+void resultswriter_destroy(ResultsWriter *rw);
+
+/**
+   Maps a table for reading; returns NULL if it is not a table
+*/
+ResultsFile *results_map(const char *path);
+
+/**
+   Points 'g' to the columns of the next group; returns 0 at the end
+*/
+int results_next(ResultsFile *rf, ResultsGroup *g);
+void results_unmap(ResultsFile *rf);
+
+#endif
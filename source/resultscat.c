@@ -0,0 +1,76 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Results reader: prints tables of results (see results.h) as text, one
+  row per line after a '#' line of column names, optionally keeping only
+  one epidemic
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include "results.h"
+
+int main(int argc, char **argv) {
+  int i, k, r, id = -1;
+  long rows = 0;
+  ResultsFile *rf;
+  ResultsGroup g;
+  char syntax[] = "\n\
+ Usage: resultscat [options] RESULTS_PATH ...\n\n\
+ Options:\n\t\
+ -i EPIDEMIC_ID (only this epidemic)\n";
+
+  while ((i = getopt(argc, argv, "i:")) != -1)
+    switch (i) {
+    case 'i':
+      id = atoi(optarg);
+      assert(id >= 0);
+      break;
+    case '?':
+      fputs(syntax, stderr);
+    default:
+      abort();
+    }
+  if (optind == argc) {
+    fputs(syntax, stderr);
+    exit(1);
+  }
+
+  for (i = optind; i < argc; i++) {
+    rf = results_map(argv[i]);
+    if (!rf) {
+      fprintf(stderr, "%s: not a table of results.\n", argv[i]);
+      exit(1);
+    }
+    if (i == optind) {
+      putchar('#');
+      for (k = 0; k < rf->num_columns; k++)
+	printf(" %s", rf->names[k]);
+      putchar('\n');
+    }
+    while (results_next(rf, &g))
+      for (r = 0; r < g.rows; r++) {
+	if (id >= 0 && ((const int *) g.columns[0])[r] != id)
+	  continue; // the first column is the epidemic id
+	for (k = 0; k < rf->num_columns; k++) {
+	  if (k > 0)
+	    putchar(' ');
+	  if (rf->types[k] == RESULTS_FLOAT64)
+	    printf("%.6f", ((const double *) g.columns[k])[r]);
+	  else
+	    printf("%d", ((const int *) g.columns[k])[r]);
+	}
+	putchar('\n');
+	rows++;
+      }
+    results_unmap(rf);
+  }
+  fprintf(stderr, "%ld rows.\n", rows);
+  return 0;
+}
@@ -0,0 +1,136 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Trace reader: streams text or binary traces, compressed or not
+  (detected from their first bytes) to text lines, to a binary trace or
+  to P2P file requests, optionally keeping only one epidemic and/or a
+  time window, or a sample of the epidemics and events; the compressed
+  blocks outside the window are skipped, and only the blocks of the
+  epidemic or window are read when the trace has a sidecar index
+  (TRACE_PATH.idx)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <limits.h>
+#include <unistd.h>
+#include "tracefile.h"
+
+int main(int argc, char **argv) {
+  int i, id = -1, from = INT_MIN, to = INT_MAX, format = TRACE_TEXT, level = 0;
+  int step_events = 0;
+  double rate = 1.0;
+  long events = 0;
+  FILE *in;
+  TraceReader *tr;
+  TraceIndex *ti;
+  long num_blocks;
+  TraceOutput *stage = NULL;
+  TraceWriter *tw = NULL;
+  RequestSink *rs = NULL;
+  TraceEvent ev;
+  char syntax[] = "\n\
+ Usage: tracecat [options] [TRACE_PATH ...] (default: standard input)\n\n\
+ Options:\n\t\
+ -i EPIDEMIC_ID (only this epidemic)\n\t\
+ -t FIRST:LAST (only the events with FIRST <= t <= LAST)\n\t\
+ -f FORMAT (output format: text, binary or requests, default: text)\n\t\
+ -z[LEVEL] (deflate the output by blocks, level 1-9, default: 6)\n\t\
+ -y SAMPLE_RATE (only a fraction of the epidemics, chosen by id)\n\t\
+ -Y STEP_EVENTS (only a sample of so many events per time step)\n";
+
+  while ((i = getopt(argc, argv, "i:t:f:z::y:Y:")) != -1)
+    switch (i) {
+    case 'i':
+      id = atoi(optarg);
+      assert(id >= 0);
+      break;
+    case 't':
+      if (sscanf(optarg, "%d:%d", &from, &to) != 2)
+	to = from;
+      assert(from <= to);
+      break;
+    case 'f':
+      format = trace_format(optarg);
+      assert(format >= 0);
+      break;
+    case 'z':
+      level = optarg? atoi(optarg) : TRACEZIP_LEVEL;
+      assert(level >= 1 && level <= 9);
+      break;
+    case 'y':
+      rate = atof(optarg);
+      assert(rate > 0.0 && rate <= 1.0);
+      break;
+    case 'Y':
+      step_events = atoi(optarg);
+      assert(step_events > 0);
+      break;
+    case '?':
+      fputs(syntax, stderr);
+    default:
+      abort();
+    }
+  assert(format != TRACE_REQUESTS || !level);
+
+  for (i = optind; i < argc || i == optind; i++) {
+    in = (i < argc)? fopen(argv[i], "rb") : stdin;
+    assert(in != NULL);
+    tr = tracereader_new(in);
+    if (!tr) {
+      fprintf(stderr, "%s: not a trace file.\n", (i < argc)? argv[i] : "stdin");
+      exit(1);
+    }
+    tracereader_window(tr, from, to);
+    ti = (i < argc && (id >= 0 || from > INT_MIN || to < INT_MAX))? traceindex_load(argv[i]) : NULL;
+    if (ti) { // seek to the blocks that may hold the events
+      num_blocks = ti->num_entries;
+      traceindex_select(ti, id, from, to);
+      tracereader_segments(tr, ti->entries, ti->num_entries);
+      fprintf(stderr, "%s: reading %ld of %ld blocks.\n", argv[i], ti->num_entries, num_blocks);
+    }
+    while (tracereader_next(tr, &ev)) {
+      if (!tw) { // the first event fixes the columns of the output
+	if (format == TRACE_REQUESTS) // branches are not part of requests
+	  tw = tracewriter_requests(rs = requests_new(stdout));
+	else
+	  tw = tracewriter_new(stage = traceoutput_new(stdout, format, tr->columns == 5? 5 : 4,
+						       2, level, 0));
+	tracewriter_sample(tw, rate, step_events);
+      }
+      if (id >= 0 && ev.f != id) {
+	tracereader_skip(tr); // frames hold a single epidemic
+	continue;
+      }
+      if (ev.t < from || ev.t > to)
+	continue;
+      if (!tracewriter_begin(tw, ev.f, ev.b)) {
+	tracereader_skip(tr); // not sampled
+	continue;
+      }
+      tracewriter_event(tw, ev.t, ev.p, ev.c);
+      events++;
+    }
+    tracereader_destroy(tr);
+    if (ti)
+      traceindex_destroy(ti);
+    if (in != stdin)
+      fclose(in);
+  }
+  if (tw)
+    tracewriter_destroy(tw);
+  if (stage)
+    traceoutput_destroy(stage);
+  if (rs) {
+    requests_write(rs);
+    requests_destroy(rs);
+  }
+  fflush(stdout);
+  fprintf(stderr, "%ld events.\n", events);
+  return 0;
+}
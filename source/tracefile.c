@@ -0,0 +1,789 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Source: trace files (text, binary or requests), shared by simplesir
+  and scascade
+*/
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include "tracefile.h"
+
+static unsigned int crc_table[256];
+static int crc_ready = 0;
+
+static void crc_init() {
+  unsigned int c;
+  int i, k;
+  if (crc_ready)
+    return;
+  for (i = 0; i < 256; i++) {
+    c = (unsigned int) i;
+    for (k = 0; k < 8; k++)
+      c = (c & 1)? 0xedb88320u ^ (c >> 1) : c >> 1;
+    crc_table[i] = c;
+  }
+  crc_ready = 1;
+}
+
+static unsigned int crc32_of(const unsigned char *buf, int len) {
+  unsigned int c = 0xffffffffu;
+  int i;
+  for (i = 0; i < len; i++)
+    c = crc_table[(c ^ buf[i]) & 0xff] ^ (c >> 8);
+  return c ^ 0xffffffffu;
+}
+
+static void put32(unsigned char *buf, unsigned int x) {
+  buf[0] = x & 0xff; buf[1] = (x >> 8) & 0xff;
+  buf[2] = (x >> 16) & 0xff; buf[3] = (x >> 24) & 0xff;
+}
+
+static unsigned int get32(const unsigned char *buf) {
+  return (unsigned int)buf[0] | ((unsigned int)buf[1] << 8) |
+    ((unsigned int)buf[2] << 16) | ((unsigned int)buf[3] << 24);
+}
+
+/**
+   Zigzag varint: small values of either sign take few bytes
+*/
+static int put_varint(unsigned char *buf, int x) {
+  unsigned int z = ((unsigned int)x << 1) ^ (unsigned int)(x >> 31);
+  int n = 0;
+  while (z >= 0x80) {
+    buf[n++] = (unsigned char)(z | 0x80);
+    z >>= 7;
+  }
+  buf[n++] = (unsigned char)z;
+  return n;
+}
+
+static int get_varint(const unsigned char *buf, int *pos, int len, int *x) {
+  unsigned int z = 0;
+  int shift = 0;
+  while (*pos < len && shift < 35) {
+    z |= (unsigned int)(buf[*pos] & 0x7f) << shift;
+    if (!(buf[(*pos)++] & 0x80)) {
+      *x = (int)(z >> 1) ^ -(int)(z & 1);
+      return 1;
+    }
+    shift += 7;
+  }
+  return 0;
+}
+
+int trace_format(const char *name) {
+  if (!strcmp(name, "text"))
+    return TRACE_TEXT;
+  if (!strcmp(name, "binary"))
+    return TRACE_BINARY;
+  if (!strcmp(name, "requests"))
+    return TRACE_REQUESTS;
+  return -1;
+}
+
+const char *trace_extension(int format, int compressed) {
+  assert(format != TRACE_REQUESTS || !compressed);
+  if (format == TRACE_REQUESTS)
+    return "requests";
+  if (format == TRACE_BINARY)
+    return compressed? "btrace.z" : "btrace";
+  return compressed? "trace.z" : "trace";
+}
+
+/**
+   Threads (de)compressing blocks: one per processor, up to
+   TRACEZIP_THREADS
+*/
+static int trace_threads() {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n < 1)
+    return 1;
+  return (n < TRACEZIP_THREADS)? (int) n : TRACEZIP_THREADS;
+}
+
+/**
+   Decimal digits of x, without the stdio machinery
+*/
+static int put_int(unsigned char *buf, int x) {
+  unsigned char digits[12];
+  unsigned int u = (x < 0)? -(unsigned int)x : (unsigned int)x;
+  int n = 0, k = 0;
+  do {
+    digits[k++] = (unsigned char)('0' + u % 10);
+    u /= 10;
+  } while (u);
+  if (x < 0)
+    buf[n++] = '-';
+  while (k > 0)
+    buf[n++] = digits[--k];
+  return n;
+}
+
+/**
+   Encodes the n events of 'ev' (same epidemic and branch) as a frame
+*/
+static int trace_frame(unsigned char *buf, TraceEvent *ev, int n) {
+  int i, len = 0, last_t = 0, last_p = 0;
+  unsigned char *payload = buf + TRACE_FRAME_HEADER;
+  for (i = 0; i < n; i++) {
+    len += put_varint(payload + len, ev[i].t - last_t);
+    len += put_varint(payload + len, ev[i].p - last_p);
+    len += put_varint(payload + len, ev[i].c);
+    last_t = ev[i].t;
+    last_p = ev[i].p;
+  }
+  put32(buf,    (unsigned int) len);
+  put32(buf+4,  (unsigned int) n);
+  put32(buf+8,  (unsigned int) ev[0].f);
+  put32(buf+12, (unsigned int) ev[0].b);
+  put32(buf+16, crc32_of(payload, len));
+  return TRACE_FRAME_HEADER + len;
+}
+
+/**
+   Formats (text) or encodes (binary) a block into 'buf'; returns its
+   size, and the time and epidemic ranges of its events in 'e'
+*/
+static int traceoutput_format(TraceOutput *to, TraceBlock *b, unsigned char *buf,
+			      TraceIndexEntry *e) {
+  int i, j, len = 0;
+  TraceEvent *ev = b->events;
+
+  e->events = b->count;
+  e->min_t = e->max_t = ev[0].t;
+  e->min_f = e->max_f = ev[0].f;
+  for (i = 1; i < b->count; i++) {
+    if (ev[i].t < e->min_t) e->min_t = ev[i].t;
+    if (ev[i].t > e->max_t) e->max_t = ev[i].t;
+    if (ev[i].f < e->min_f) e->min_f = ev[i].f;
+    if (ev[i].f > e->max_f) e->max_f = ev[i].f;
+  }
+  if (to->format == TRACE_BINARY) {
+    for (i = 0; i < b->count; i = j) { // one frame per epidemic and branch
+      for (j = i+1; j < b->count && ev[j].f == ev[i].f && ev[j].b == ev[i].b; j++);
+      len += trace_frame(buf+len, ev+i, j-i);
+    }
+    return len;
+  }
+  for (i = 0; i < b->count; i++) {
+    len += put_int(buf+len, ev[i].t);  buf[len++] = ' ';
+    len += put_int(buf+len, ev[i].p);  buf[len++] = ' ';
+    len += put_int(buf+len, ev[i].c);  buf[len++] = ' ';
+    len += put_int(buf+len, ev[i].f);
+    if (to->columns == 5) {
+      buf[len++] = ' ';
+      len += put_int(buf+len, ev[i].b);
+    }
+    buf[len++] = '\n';
+  }
+  return len;
+}
+
+/**
+   Output thread: formats (and compresses) the blocks it takes from the
+   queue, then writes them (and their index entries) in their order
+*/
+static void *traceoutput_thread(void *arg) {
+  TraceOutput *to = (TraceOutput *) arg;
+  TraceBlock *b;
+  unsigned char *buf = (unsigned char *) malloc(TRACE_BLOCK_BYTES), *zbuf = NULL, *data;
+  int len, raw_len;
+  TraceIndexEntry e;
+  long seq;
+
+  if (to->level)
+    zbuf = (unsigned char *) malloc(tracezip_bound(TRACE_BLOCK_BYTES));
+  assert(buf != NULL && (zbuf != NULL || !to->level));
+  pthread_mutex_lock(&to->lock);
+  for (;;) {
+    while (!to->head && !to->done)
+      pthread_cond_wait(&to->ready, &to->lock);
+    if (!to->head)
+      break;
+    b = to->head;
+    to->head = b->next;
+    if (!to->head)
+      to->tail = NULL;
+    to->busy++;
+    pthread_mutex_unlock(&to->lock);
+    len   = raw_len = traceoutput_format(to, b, buf, &e);
+    seq   = b->seq;
+    pthread_mutex_lock(&to->lock);
+    b->count = 0; // formatted: back to the pool
+    b->next = to->free_blocks;
+    to->free_blocks = b;
+    pthread_cond_broadcast(&to->released);
+    pthread_mutex_unlock(&to->lock);
+    data = buf;
+    if (to->level) {
+      len  = tracezip_block(zbuf, buf, raw_len, e.min_t, e.max_t, to->level);
+      data = zbuf;
+    }
+    pthread_mutex_lock(&to->lock);
+    while (to->next_write != seq)
+      pthread_cond_wait(&to->released, &to->lock);
+    pthread_mutex_unlock(&to->lock);
+    fwrite(data, 1, len, to->out); // our turn: the others wait for next_write
+    if (to->level)
+      tracezip_index_add(&to->index, to->offset, len - TRACEZIP_BLOCK_HEADER, raw_len,
+			 e.min_t, e.max_t);
+    if (to->trace_index) {
+      e.offset = to->offset;
+      e.length = len;
+      traceindex_add(to->trace_index, &e);
+    }
+    to->offset += len;
+    pthread_mutex_lock(&to->lock);
+    to->next_write++;
+    to->events += e.events;
+    to->busy--;
+    pthread_cond_broadcast(&to->released);
+  }
+  pthread_mutex_unlock(&to->lock);
+  free(buf);
+  free(zbuf);
+  return NULL;
+}
+
+TraceOutput *traceoutput_new(FILE *out, int format, int columns, int num_blocks,
+			     int level, int append) {
+  unsigned char header[TRACE_HEADER_SIZE], *zbuf;
+  int i, len;
+  TraceOutput *to = (TraceOutput *) calloc(1, sizeof(TraceOutput));
+  assert(to != NULL && out != NULL);
+  assert(format == TRACE_TEXT || format == TRACE_BINARY);
+  assert(columns == 4 || columns == 5);
+  assert(num_blocks > 0 && level >= 0 && level <= 9);
+  crc_init();
+  to->out     = out;
+  to->format  = format;
+  to->columns = columns;
+  to->level   = level;
+  to->num_blocks = num_blocks;
+  assert(TRACE_BLOCK_EVENTS*(TRACE_FRAME_HEADER + TRACE_EVENT_SIZE) <= TRACE_BLOCK_BYTES);
+  to->blocks  = (TraceBlock *) calloc(num_blocks, sizeof(TraceBlock));
+  assert(to->blocks != NULL);
+  for (i = 0; i < num_blocks; i++) {
+    to->blocks[i].events = (TraceEvent *) malloc(TRACE_BLOCK_EVENTS * sizeof(TraceEvent));
+    assert(to->blocks[i].events != NULL);
+    to->blocks[i].next = to->free_blocks;
+    to->free_blocks = to->blocks+i;
+  }
+  tracezip_index_init(&to->index);
+  if (level && append)
+    tracezip_index_scan(&to->index, out); // resumed: blocks already written
+  else if (level) {
+    tracezip_header(out);
+    to->offset = TRACEZIP_HEADER_SIZE;
+  }
+  if (append)
+    to->offset = ftell(out);
+  if (format == TRACE_BINARY && !append) {
+    memcpy(header, TRACE_MAGIC, 8);
+    header[8]  = TRACE_VERSION;
+    header[9]  = (unsigned char) columns;
+    header[10] = header[11] = 0;
+    if (level) { // a block of its own, never skipped by the readers
+      zbuf = (unsigned char *) malloc(tracezip_bound(TRACE_HEADER_SIZE));
+      assert(zbuf != NULL);
+      len = tracezip_block(zbuf, header, TRACE_HEADER_SIZE, INT_MIN, INT_MAX, level);
+      fwrite(zbuf, 1, len, out);
+      tracezip_index_add(&to->index, to->offset, len - TRACEZIP_BLOCK_HEADER,
+			 TRACE_HEADER_SIZE, INT_MIN, INT_MAX);
+      to->offset += len;
+      free(zbuf);
+    } else {
+      fwrite(header, 1, TRACE_HEADER_SIZE, out);
+      to->offset = TRACE_HEADER_SIZE;
+    }
+  }
+  to->num_threads = level? trace_threads() : 1;
+  to->threads = (pthread_t *) malloc(to->num_threads * sizeof(pthread_t));
+  assert(to->threads != NULL);
+  pthread_mutex_init(&to->lock, NULL);
+  pthread_cond_init(&to->ready, NULL);
+  pthread_cond_init(&to->released, NULL);
+  for (i = 0; i < to->num_threads; i++)
+    if (pthread_create(to->threads+i, NULL, traceoutput_thread, to) != 0) {
+      perror("traceoutput_new: pthread_create");
+      exit(-1);
+    }
+  return to;
+}
+
+void traceoutput_index(TraceOutput *to, FILE *idx) {
+  to->trace_index = idx;
+}
+
+/**
+   Takes a free block; waits for the output thread if there is none, so
+   that the memory of the stage stays bounded
+*/
+static TraceBlock *traceoutput_acquire(TraceOutput *to) {
+  TraceBlock *b;
+  pthread_mutex_lock(&to->lock);
+  while (!to->free_blocks)
+    pthread_cond_wait(&to->released, &to->lock);
+  b = to->free_blocks;
+  to->free_blocks = b->next;
+  pthread_mutex_unlock(&to->lock);
+  b->count = 0;
+  b->next  = NULL;
+  return b;
+}
+
+static void traceoutput_submit(TraceOutput *to, TraceBlock *b) {
+  pthread_mutex_lock(&to->lock);
+  if (b->count == 0) { // nothing to write: back to the pool
+    b->next = to->free_blocks;
+    to->free_blocks = b;
+    pthread_cond_broadcast(&to->released);
+  } else {
+    b->next = NULL;
+    b->seq  = to->next_seq++;
+    if (to->tail)
+      to->tail->next = b;
+    else
+      to->head = b;
+    to->tail = b;
+    pthread_cond_signal(&to->ready);
+  }
+  pthread_mutex_unlock(&to->lock);
+}
+
+void traceoutput_sync(TraceOutput *to) {
+  pthread_mutex_lock(&to->lock);
+  while (to->head || to->busy)
+    pthread_cond_wait(&to->released, &to->lock);
+  pthread_mutex_unlock(&to->lock);
+  fflush(to->out);
+  if (to->trace_index)
+    fflush(to->trace_index);
+}
+
+void traceoutput_destroy(TraceOutput *to) {
+  int i;
+  assert(to != NULL);
+  pthread_mutex_lock(&to->lock);
+  to->done = 1;
+  pthread_cond_broadcast(&to->ready);
+  pthread_mutex_unlock(&to->lock);
+  for (i = 0; i < to->num_threads; i++)
+    pthread_join(to->threads[i], NULL);
+  if (to->level)
+    tracezip_index_write(&to->index, to->out, to->offset);
+  fflush(to->out);
+  if (to->trace_index)
+    fclose(to->trace_index);
+  tracezip_index_free(&to->index);
+  pthread_mutex_destroy(&to->lock);
+  pthread_cond_destroy(&to->ready);
+  pthread_cond_destroy(&to->released);
+  for (i = 0; i < to->num_blocks; i++)
+    free(to->blocks[i].events);
+  free(to->blocks);
+  free(to->threads);
+  free(to);
+}
+
+/**
+   Mixes the bits of x (an integer finalizer), for reproducible sampling
+*/
+static unsigned int trace_hash(unsigned int x) {
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+int trace_sampled(int id, double rate) {
+  return rate >= 1.0 || trace_hash((unsigned int) id) < rate * 4294967296.0;
+}
+
+TraceWriter *tracewriter_new(TraceOutput *to) {
+  TraceWriter *tw = (TraceWriter *) calloc(1, sizeof(TraceWriter));
+  assert(tw != NULL);
+  tw->output  = to;
+  tw->rate    = 1.0;
+  tw->sampled = 1;
+  return tw;
+}
+
+TraceWriter *tracewriter_requests(RequestSink *rs) {
+  TraceWriter *tw = (TraceWriter *) calloc(1, sizeof(TraceWriter));
+  assert(tw != NULL);
+  tw->sink    = rs;
+  tw->rate    = 1.0;
+  tw->sampled = 1;
+  return tw;
+}
+
+TraceWriter *tracewriter_callback(TraceCallback callback, void *user) {
+  TraceWriter *tw = (TraceWriter *) calloc(1, sizeof(TraceWriter));
+  assert(tw != NULL && callback != NULL);
+  tw->callback = callback;
+  tw->user     = user;
+  tw->batch    = (TraceEvent *) malloc(TRACE_CALLBACK_EVENTS * sizeof(TraceEvent));
+  assert(tw->batch != NULL);
+  tw->rate     = 1.0;
+  tw->sampled  = 1;
+  return tw;
+}
+
+void tracewriter_sample(TraceWriter *tw, double rate, int step_events) {
+  assert(rate > 0.0 && rate <= 1.0 && step_events >= 0);
+  tw->rate        = rate;
+  tw->sampled     = trace_sampled(tw->id, rate);
+  tw->step_events = step_events;
+  tw->reservoir   = (TraceEvent *) realloc(tw->reservoir, (step_events + 1) * sizeof(TraceEvent));
+  assert(tw->reservoir != NULL);
+}
+
+/**
+   Hands an event over to the sink or to the output stage
+*/
+static void tracewriter_put(TraceWriter *tw, int t, int p, int c) {
+  TraceEvent *ev;
+  if (tw->sink) {
+    if (tw->num_events == tw->max_events) {
+      tw->max_events = tw->max_events? 2*tw->max_events : 256;
+      tw->events = (int *) realloc(tw->events, 3 * tw->max_events * sizeof(int));
+      assert(tw->events != NULL);
+    }
+    tw->events[3*tw->num_events]   = t;
+    tw->events[3*tw->num_events+1] = p;
+    tw->events[3*tw->num_events+2] = c;
+    tw->num_events++;
+    return;
+  }
+  if (tw->callback) {
+    ev = tw->batch + tw->batched++;
+    ev->t = t;
+    ev->p = p;
+    ev->c = c;
+    ev->f = tw->id;
+    ev->b = tw->branch;
+    if (tw->batched == TRACE_CALLBACK_EVENTS) {
+      tw->callback(tw->user, tw->batch, tw->batched);
+      tw->batched = 0;
+    }
+    return;
+  }
+  if (!tw->block)
+    tw->block = traceoutput_acquire(tw->output);
+  ev = tw->block->events + tw->block->count++;
+  ev->t = t;
+  ev->p = p;
+  ev->c = c;
+  ev->f = tw->id;
+  ev->b = tw->branch;
+  if (tw->block->count == TRACE_BLOCK_EVENTS) {
+    traceoutput_submit(tw->output, tw->block);
+    tw->block = NULL;
+  }
+}
+
+/**
+   Hands over the events kept from the current time step
+*/
+static void tracewriter_step(TraceWriter *tw) {
+  int i;
+  for (i = 0; i < tw->kept; i++)
+    tracewriter_put(tw, tw->reservoir[i].t, tw->reservoir[i].p, tw->reservoir[i].c);
+  tw->kept = 0;
+  tw->seen = 0;
+}
+
+int tracewriter_begin(TraceWriter *tw, int id, int branch) {
+  if (tw->id != id || tw->branch != branch) {
+    tracewriter_step(tw);
+    if (tw->sink)
+      tracewriter_flush(tw); // one run per epidemic
+  }
+  tw->id      = id;
+  tw->branch  = branch;
+  tw->sampled = trace_sampled(id, tw->rate);
+  return tw->sampled;
+}
+
+void tracewriter_event(TraceWriter *tw, int t, int p, int c) {
+  TraceEvent *ev;
+  unsigned long j;
+  if (!tw->sampled)
+    return;
+  if (!tw->step_events) {
+    tracewriter_put(tw, t, p, c);
+    return;
+  }
+  if (tw->kept > 0 && tw->reservoir[0].t != t)
+    tracewriter_step(tw); // a new time step
+  if (tw->kept < tw->step_events)
+    ev = tw->reservoir + tw->kept++;
+  else { // keeps the event with probability step_events/(seen+1)
+    j = trace_hash(trace_hash(tw->id ^ trace_hash(t)) ^ (unsigned int) tw->seen) %
+      (unsigned long)(tw->seen + 1);
+    ev = (j < (unsigned long) tw->step_events)? tw->reservoir + j : NULL;
+  }
+  if (ev) {
+    ev->t = t;
+    ev->p = p;
+    ev->c = c;
+  }
+  tw->seen++;
+}
+
+void tracewriter_flush(TraceWriter *tw) {
+  tracewriter_step(tw);
+  if (tw->sink && tw->num_events > 0) {
+    requests_add(tw->sink, tw->id, tw->events, tw->num_events);
+    tw->events     = NULL; // owned by the sink
+    tw->num_events = tw->max_events = 0;
+  }
+  if (tw->callback && tw->batched > 0) {
+    tw->callback(tw->user, tw->batch, tw->batched);
+    tw->batched = 0;
+  }
+  if (tw->block) {
+    traceoutput_submit(tw->output, tw->block);
+    tw->block = NULL;
+  }
+}
+
+void tracewriter_destroy(TraceWriter *tw) {
+  assert(tw != NULL);
+  tracewriter_flush(tw);
+  free(tw->events);
+  free(tw->reservoir);
+  free(tw->batch);
+  free(tw);
+}
+
+/**
+   Makes the next decompressed bytes (or bytes of the next segment)
+   available; returns 0 at the end
+*/
+static int tracereader_fill(TraceReader *tr) {
+  const TraceIndexEntry *e;
+  while (tr->raw_pos == tr->raw_len) {
+    if (tr->zip) {
+      if (!tracezip_next(tr->zip, &tr->raw, &tr->raw_len))
+	return 0;
+    } else { // segment of a plain trace
+      if (tr->next_segment == tr->num_segments)
+	return 0;
+      e = tr->segments + tr->next_segment++;
+      if (e->length > tr->segment_capacity) {
+	tr->segment_capacity = e->length;
+	tr->segment = (unsigned char *) realloc(tr->segment, tr->segment_capacity);
+	assert(tr->segment != NULL);
+      }
+      if (fseek(tr->in, e->offset, SEEK_SET) != 0 ||
+	  fread(tr->segment, 1, e->length, tr->in) != (size_t) e->length) {
+	fprintf(stderr, "Truncated trace: indexed block at %ld.\n", e->offset);
+	return 0;
+      }
+      tr->raw     = tr->segment;
+      tr->raw_len = e->length;
+    }
+    tr->raw_pos = 0;
+  }
+  return 1;
+}
+
+/**
+   Reads n bytes of the trace, from the file or from its blocks
+*/
+static size_t tracereader_read(TraceReader *tr, unsigned char *buf, size_t n) {
+  size_t k, done = 0;
+  if (!tr->zip && !tr->segments)
+    return fread(buf, 1, n, tr->in);
+  while (done < n && tracereader_fill(tr)) {
+    k = tr->raw_len - tr->raw_pos;
+    if (k > n - done)
+      k = n - done;
+    memcpy(buf + done, tr->raw + tr->raw_pos, k);
+    tr->raw_pos += k;
+    done += k;
+  }
+  return done;
+}
+
+/**
+   Reads a text line of the trace, as fgets
+*/
+static char *tracereader_gets(TraceReader *tr, char *line, int size) {
+  int n = 0;
+  if (!tr->zip && !tr->segments)
+    return fgets(line, size, tr->in);
+  while (n < size-1 && tracereader_fill(tr))
+    if ((line[n++] = (char) tr->raw[tr->raw_pos++]) == '\n')
+      break;
+  line[n] = '\0';
+  return n? line : NULL;
+}
+
+/**
+   Detects the format (and compression) of the trace; returns 0 if a
+   header is corrupted
+*/
+static int tracereader_header(TraceReader *tr) {
+  unsigned char header[TRACE_HEADER_SIZE];
+  int c = getc(tr->in);
+  if (c != EOF)
+    ungetc(c, tr->in);
+  if (c == TRACEZIP_MAGIC[0]) { // both headers start alike
+    if (fread(header, 1, TRACE_HEADER_SIZE, tr->in) != TRACE_HEADER_SIZE)
+      return 0;
+    if (!memcmp(header, TRACEZIP_MAGIC, 8)) { // compressed trace
+      if (header[8] != TRACEZIP_VERSION || header[9] != TRACEZIP_DEFLATE)
+	return 0;
+      tr->zip = tracezip_open(tr->in, trace_threads());
+      c = tracereader_fill(tr)? tr->raw[tr->raw_pos] : EOF;
+      if (c == TRACE_MAGIC[0] &&
+	  tracereader_read(tr, header, TRACE_HEADER_SIZE) != TRACE_HEADER_SIZE)
+	return 0;
+    }
+  }
+  if (c != TRACE_MAGIC[0]) { // text lines start with a digit
+    tr->format  = TRACE_TEXT;
+    tr->columns = 0;         // from the first line
+    return 1;
+  }
+  tr->format  = TRACE_BINARY;
+  tr->columns = header[9];
+  return !memcmp(header, TRACE_MAGIC, 8) && header[8] == TRACE_VERSION &&
+    (header[9] == 4 || header[9] == 5);
+}
+
+TraceReader *tracereader_new(FILE *in) {
+  TraceReader *tr;
+  assert(in != NULL);
+  crc_init();
+  tr = (TraceReader *) calloc(1, sizeof(TraceReader));
+  assert(tr != NULL);
+  tr->in = in;
+  if (!tracereader_header(tr)) {
+    tracereader_destroy(tr);
+    return NULL;
+  }
+  return tr;
+}
+
+void tracereader_window(TraceReader *tr, int from, int to) {
+  if (tr->zip)
+    tracezip_window(tr->zip, from, to);
+}
+
+void tracereader_segments(TraceReader *tr, const TraceIndexEntry *e, long n) {
+  long i;
+  tr->segments     = e;
+  tr->num_segments = n;
+  tr->next_segment = 0;
+  tr->raw_pos = tr->raw_len = 0; // drops what was read ahead
+  tr->left = 0;
+  if (tr->zip) {
+    tr->offsets = (long *) realloc(tr->offsets, (n > 0? n : 1) * sizeof(long));
+    assert(tr->offsets != NULL);
+    for (i = 0; i < n; i++)
+      tr->offsets[i] = e[i].offset;
+    tracezip_blocks(tr->zip, tr->offsets, n);
+  }
+}
+
+/**
+   Loads the next frame of a binary trace; returns 0 at the end
+*/
+static int tracereader_frame(TraceReader *tr) {
+  unsigned char header[TRACE_FRAME_HEADER];
+  size_t n = tracereader_read(tr, header, TRACE_FRAME_HEADER);
+  if (n == 0)
+    return 0;
+  if (n != TRACE_FRAME_HEADER) {
+    fprintf(stderr, "Truncated frame header after %ld frames.\n", tr->frames);
+    return 0;
+  }
+  tr->len     = (int) get32(header);
+  tr->left    = (int) get32(header+4);
+  tr->frame.f = (int) get32(header+8);
+  tr->frame.b = (int) get32(header+12);
+  if (tr->len > tr->capacity) {
+    tr->capacity = tr->len;
+    tr->buf = (unsigned char *) realloc(tr->buf, tr->capacity);
+    assert(tr->buf != NULL);
+  }
+  if (tracereader_read(tr, tr->buf, tr->len) != (size_t) tr->len) {
+    fprintf(stderr, "Truncated frame after %ld frames.\n", tr->frames);
+    return 0;
+  }
+  if (crc32_of(tr->buf, tr->len) != get32(header+16)) {
+    fprintf(stderr, "Checksum mismatch in frame %ld (epidemic %d).\n",
+	    tr->frames, tr->frame.f);
+    return 0;
+  }
+  tr->frames++;
+  tr->pos    = 0;
+  tr->last_t = tr->last_p = 0;
+  return 1;
+}
+
+int tracereader_next(TraceReader *tr, TraceEvent *ev) {
+  char line[256];
+  int dt, dp, n;
+
+  if (tr->format == TRACE_TEXT) {
+    while (tracereader_gets(tr, line, sizeof(line))) {
+      n = sscanf(line, "%d %d %d %d %d", &ev->t, &ev->p, &ev->c, &ev->f, &ev->b);
+      if (n < 4)
+	continue;
+      if (!tr->columns)
+	tr->columns = n;
+      if (n == 4)
+	ev->b = 0;
+      return 1;
+    }
+    return 0;
+  }
+  while (tr->left == 0)
+    if (!tracereader_frame(tr))
+      return 0;
+  if (!get_varint(tr->buf, &tr->pos, tr->len, &dt) ||
+      !get_varint(tr->buf, &tr->pos, tr->len, &dp) ||
+      !get_varint(tr->buf, &tr->pos, tr->len, &ev->c)) {
+    fprintf(stderr, "Corrupted frame %ld (epidemic %d).\n", tr->frames, tr->frame.f);
+    tr->left = 0;
+    return 0;
+  }
+  tr->last_t += dt;
+  tr->last_p += dp;
+  ev->t = tr->last_t;
+  ev->p = tr->last_p;
+  ev->f = tr->frame.f;
+  ev->b = tr->frame.b;
+  tr->left--;
+  return 1;
+}
+
+void tracereader_skip(TraceReader *tr) {
+  tr->left = 0;
+}
+
+void tracereader_destroy(TraceReader *tr) {
+  assert(tr != NULL);
+  if (tr->zip)
+    tracezip_close(tr->zip);
+  free(tr->buf);
+  free(tr->offsets);
+  free(tr->segment);
+  free(tr);
+}
@@ -0,0 +1,242 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Header: trace files, as text lines (t P C F [B]) or in a compact binary
+  format shared by simplesir and scascade.
+
+  Binary format: a 12 bytes file header ("SIRTRACE", version, number of
+  columns, 2 reserved bytes) followed by frames. A frame holds events of
+  a single epidemic (and branch): a 20 bytes header (payload length,
+  number of events, epidemic id, branch, CRC-32 of the payload; 32 bits
+  little endian each) and a payload of zigzag varints per event: time
+  minus the previous time, provider minus the previous provider, client.
+
+  Request format: the events are kept in memory and written at the end
+  as P2P file requests (t C F P1 ... Pn), see requests.h.
+
+  Text and binary traces go through an output stage: the simulation
+  threads fill blocks of raw events, taken from a bounded pool, and
+  background threads format (or encode) them and write them out, so
+  that simulation and I/O overlap. Compressed traces (see tracezip.h)
+  deflate each formatted block on one of several output threads; the
+  blocks are still written in the order they were handed over. A sidecar
+  index (see traceindex.h) records where each block went, so that readers
+  can seek to the blocks of an epidemic or a time window.
+*/
+#ifndef TRACEFILE_H
+#define TRACEFILE_H
+#include <stdio.h>
+#include <pthread.h>
+#include "requests.h"
+#include "tracezip.h"
+#include "traceindex.h"
+
+#define TRACE_TEXT   0
+#define TRACE_BINARY 1
+#define TRACE_REQUESTS 2
+
+#define TRACE_MAGIC        "SIRTRACE"
+#define TRACE_VERSION      1
+#define TRACE_HEADER_SIZE  12
+#define TRACE_FRAME_HEADER 20
+#define TRACE_EVENT_SIZE   15      // max bytes of an encoded event
+#define TRACE_LINE_SIZE    60      // max bytes of a text line
+#define TRACE_BLOCK_EVENTS 65536   // events per block of the output stage
+#define TRACE_BLOCK_BYTES  (TRACE_BLOCK_EVENTS*TRACE_LINE_SIZE) // formatted block
+#define TRACE_CALLBACK_EVENTS 4096 // events per batch handed to a callback
+
+typedef struct _TraceEvent {
+  int t;                   // time
+  int p;                   // provider
+  int c;                   // client
+  int f;                   // file (epidemic id)
+  int b;                   // branch (columns = 5 only)
+} TraceEvent;
+
+typedef struct _TraceBlock {
+  int count;               // events in the block
+  long seq;                // order of the block in the output
+  TraceEvent *events;
+  struct _TraceBlock *next;
+} TraceBlock;
+
+typedef struct _TraceOutput {
+  FILE *out;
+  int format;              // TRACE_TEXT or TRACE_BINARY
+  int columns;             // 4: t P C F, 5: t P C F B
+  TraceBlock *blocks;      // pool of blocks (bounded memory)
+  int num_blocks;
+  TraceBlock *free_blocks; // blocks available to the writers
+  TraceBlock *head, *tail; // blocks waiting for the output threads
+  int busy;                // blocks being formatted or written
+  int done;
+  int level;               // compression level (0: none)
+  long next_seq;           // order of the next block handed over
+  long next_write;         // order of the next block to write
+  long offset;             // size of the output
+  TraceZipIndex index;     // blocks of a compressed trace
+  FILE *trace_index;       // sidecar index (see traceindex.h), or NULL
+  long events;             // events written
+  pthread_t *threads;
+  int num_threads;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;    // a block was queued (or done)
+  pthread_cond_t released; // a block was taken, or written
+} TraceOutput;
+
+/**
+   Receiver of the events of a writer, by batches (eg, of an embedding
+   program, see scascade.h)
+*/
+typedef void (*TraceCallback)(void *user, const TraceEvent *events, int count);
+
+typedef struct _TraceWriter {
+  TraceOutput *output;     // text or binary: blocks of the output stage
+  TraceBlock *block;
+  RequestSink *sink;       // request format: run of the current epidemic
+  TraceCallback callback;  // callback: batch of events, in 'batch'
+  void *user;
+  TraceEvent *batch;
+  int batched;
+  int *events;
+  int num_events, max_events;
+  int id;                  // current epidemic
+  int branch;              // current branch
+  double rate;             // fraction of the epidemics traced
+  int sampled;             // the current epidemic is traced
+  int step_events;         // events kept per time step (0: all)
+  TraceEvent *reservoir;   // sample of the events of the current step
+  int kept;                // events in the reservoir
+  long seen;               // events of the current step
+} TraceWriter;
+
+typedef struct _TraceReader {
+  FILE *in;
+  int format;
+  int columns;
+  TraceEvent frame;        // id and branch of the current frame
+  int left;                // events left in the current frame
+  int last_t, last_p;
+  unsigned char *buf;
+  int pos, len, capacity;
+  long frames;             // frames read so far
+  TraceZip *zip;           // compressed trace, or NULL
+  unsigned char *raw;      // current decompressed block (or segment)
+  int raw_pos, raw_len;
+  const TraceIndexEntry *segments; // blocks to read, or NULL: all
+  long num_segments, next_segment;
+  long *offsets;           // of the segments (compressed traces)
+  unsigned char *segment;  // current segment (plain traces)
+  int segment_capacity;
+} TraceReader;
+
+/**
+   Parses a format name ("text", "binary" or "requests"); returns -1 if
+   unknown
+*/
+int trace_format(const char *name);
+
+/**
+   File name extension of the traces in the given format, compressed or
+   not ("trace", "trace.z", ...)
+*/
+const char *trace_extension(int format, int compressed);
+
+/**
+   Starts the output stage of a text or binary trace on 'out', with a
+   pool of 'num_blocks' blocks, compressed at 'level' (0: plain trace);
+   the file header is written unless the trace is resumed ('append')
+*/
+TraceOutput *traceoutput_new(FILE *out, int format, int columns, int num_blocks,
+			     int level, int append);
+
+/**
+   Writes an entry of the sidecar index 'idx' (see traceindex_create) per
+   block; the index is closed with the output stage
+*/
+void traceoutput_index(TraceOutput *to, FILE *idx);
+
+/**
+   Waits until the blocks handed so far are written and flushed, eg,
+   before the size of the output is recorded in a checkpoint
+*/
+void traceoutput_sync(TraceOutput *to);
+
+/**
+   Writes the remaining blocks (and the index of a compressed trace) and
+   stops the output threads; the stream is left open
+*/
+void traceoutput_destroy(TraceOutput *to);
+
+/**
+   Starts a writer of events of one thread, into the output stage 'to',
+   into the request format sink 'rs', or to 'callback' by batches of
+   TRACE_CALLBACK_EVENTS (and on flush)
+*/
+TraceWriter *tracewriter_new(TraceOutput *to);
+TraceWriter *tracewriter_requests(RequestSink *rs);
+TraceWriter *tracewriter_callback(TraceCallback callback, void *user);
+
+/**
+   Whether epidemic 'id' is part of a sample of a fraction 'rate' of the
+   epidemics: decided by a hash of the id, so that runs (and engines)
+   agree on the sample
+*/
+int trace_sampled(int id, double rate);
+
+/**
+   Traces only the sampled epidemics (see trace_sampled) and, if
+   'step_events' > 0, a uniform sample of at most that many events per
+   time step of each epidemic (reservoir sampling, also seeded by hashes)
+*/
+void tracewriter_sample(TraceWriter *tw, double rate, int step_events);
+
+/**
+   Selects the epidemic (and branch) of the next events; returns 0 if the
+   epidemic is not sampled, so that its events need not be handed over
+*/
+int tracewriter_begin(TraceWriter *tw, int id, int branch);
+void tracewriter_event(TraceWriter *tw, int t, int p, int c);
+
+/**
+   Hands the pending events over: the current block to the output stage,
+   or the current run to the request sink
+*/
+void tracewriter_flush(TraceWriter *tw);
+void tracewriter_destroy(TraceWriter *tw);
+
+/**
+   Opens a trace for reading, detecting its format (and compression)
+   from its first bytes; returns NULL if a header is corrupted
+*/
+TraceReader *tracereader_new(FILE *in);
+
+/**
+   Compressed traces: skips the blocks without events in [from, to]
+*/
+void tracereader_window(TraceReader *tr, int from, int to);
+
+/**
+   Reads only the 'n' blocks of the index entries 'e' (see
+   traceindex_select), which must stay valid while reading
+*/
+void tracereader_segments(TraceReader *tr, const TraceIndexEntry *e, long n);
+
+/**
+   Reads the next event; returns 1 on success, 0 at the end of the trace.
+   A frame with a wrong checksum stops the reading with a message.
+*/
+int tracereader_next(TraceReader *tr, TraceEvent *ev);
+
+/**
+   Skips the rest of the current frame (binary traces) without decoding
+*/
+void tracereader_skip(TraceReader *tr);
+void tracereader_destroy(TraceReader *tr);
+
+#endif
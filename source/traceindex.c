@@ -0,0 +1,140 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Source: sidecar index of a trace
+*/
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "traceindex.h"
+
+static void idx_put32(unsigned char *buf, unsigned int x) {
+  buf[0] = x & 0xff; buf[1] = (x >> 8) & 0xff;
+  buf[2] = (x >> 16) & 0xff; buf[3] = (x >> 24) & 0xff;
+}
+
+static unsigned int idx_get32(const unsigned char *buf) {
+  return (unsigned int)buf[0] | ((unsigned int)buf[1] << 8) |
+    ((unsigned int)buf[2] << 16) | ((unsigned int)buf[3] << 24);
+}
+
+static void idx_entry(const unsigned char *buf, TraceIndexEntry *e) {
+  e->offset = (long)((unsigned long) idx_get32(buf) | ((unsigned long) idx_get32(buf+4) << 32));
+  e->length = (int) idx_get32(buf+8);
+  e->events = (int) idx_get32(buf+12);
+  e->min_t  = (int) idx_get32(buf+16);
+  e->max_t  = (int) idx_get32(buf+20);
+  e->min_f  = (int) idx_get32(buf+24);
+  e->max_f  = (int) idx_get32(buf+28);
+}
+
+static int idx_header(FILE *f) {
+  unsigned char header[TRACEINDEX_HEADER_SIZE];
+  return fread(header, 1, TRACEINDEX_HEADER_SIZE, f) == TRACEINDEX_HEADER_SIZE &&
+    !memcmp(header, TRACEINDEX_MAGIC, 8) && idx_get32(header+8) == TRACEINDEX_VERSION;
+}
+
+FILE *traceindex_create(const char *trace_path, long trace_size, int append) {
+  unsigned char buf[TRACEINDEX_ENTRY_SIZE];
+  char path[4096];
+  long size = TRACEINDEX_HEADER_SIZE;
+  TraceIndexEntry e;
+  FILE *idx;
+
+  snprintf(path, sizeof(path), "%s%s", trace_path, TRACEINDEX_SUFFIX);
+  if (append) { // keep the blocks written before the checkpoint
+    idx = fopen(path, "r+");
+    if (!idx || !idx_header(idx)) {
+      fprintf(stderr, "No index of the resumed trace %s: not indexed.\n", trace_path);
+      if (idx)
+	fclose(idx);
+      remove(path);
+      return NULL;
+    }
+    while (fread(buf, 1, TRACEINDEX_ENTRY_SIZE, idx) == TRACEINDEX_ENTRY_SIZE) {
+      idx_entry(buf, &e);
+      if (e.offset + e.length > trace_size)
+	break;
+      size += TRACEINDEX_ENTRY_SIZE;
+    }
+    fflush(idx);
+    if (ftruncate(fileno(idx), size) != 0)
+      perror("traceindex_create: ftruncate");
+    fseek(idx, size, SEEK_SET);
+    return idx;
+  }
+  idx = fopen(path, "w");
+  assert(idx != NULL);
+  memset(buf, 0, TRACEINDEX_HEADER_SIZE);
+  memcpy(buf, TRACEINDEX_MAGIC, 8);
+  idx_put32(buf+8, TRACEINDEX_VERSION);
+  fwrite(buf, 1, TRACEINDEX_HEADER_SIZE, idx);
+  return idx;
+}
+
+void traceindex_add(FILE *idx, TraceIndexEntry *e) {
+  unsigned char buf[TRACEINDEX_ENTRY_SIZE];
+  idx_put32(buf,    (unsigned int)((unsigned long) e->offset & 0xffffffffu));
+  idx_put32(buf+4,  (unsigned int)((unsigned long) e->offset >> 32));
+  idx_put32(buf+8,  (unsigned int) e->length);
+  idx_put32(buf+12, (unsigned int) e->events);
+  idx_put32(buf+16, (unsigned int) e->min_t);
+  idx_put32(buf+20, (unsigned int) e->max_t);
+  idx_put32(buf+24, (unsigned int) e->min_f);
+  idx_put32(buf+28, (unsigned int) e->max_f);
+  fwrite(buf, 1, TRACEINDEX_ENTRY_SIZE, idx);
+}
+
+TraceIndex *traceindex_load(const char *trace_path) {
+  unsigned char buf[TRACEINDEX_ENTRY_SIZE];
+  char path[4096];
+  long capacity = 0;
+  TraceIndex *ti;
+  FILE *idx;
+
+  snprintf(path, sizeof(path), "%s%s", trace_path, TRACEINDEX_SUFFIX);
+  idx = fopen(path, "rb");
+  if (!idx)
+    return NULL;
+  if (!idx_header(idx)) {
+    fclose(idx);
+    return NULL;
+  }
+  ti = (TraceIndex *) calloc(1, sizeof(TraceIndex));
+  assert(ti != NULL);
+  while (fread(buf, 1, TRACEINDEX_ENTRY_SIZE, idx) == TRACEINDEX_ENTRY_SIZE) {
+    if (ti->num_entries == capacity) {
+      capacity = capacity? 2*capacity : 1024;
+      ti->entries = (TraceIndexEntry *) realloc(ti->entries, capacity * sizeof(TraceIndexEntry));
+      assert(ti->entries != NULL);
+    }
+    idx_entry(buf, ti->entries + ti->num_entries++);
+  }
+  fclose(idx);
+  return ti;
+}
+
+long traceindex_select(TraceIndex *ti, int id, int from, int to) {
+  long i, n = 0;
+  TraceIndexEntry *e;
+  for (i = 0; i < ti->num_entries; i++) {
+    e = ti->entries + i;
+    if ((id < 0 || (e->min_f <= id && id <= e->max_f)) && e->max_t >= from && e->min_t <= to)
+      ti->entries[n++] = *e;
+  }
+  ti->num_entries = n;
+  return n;
+}
+
+void traceindex_destroy(TraceIndex *ti) {
+  assert(ti != NULL);
+  free(ti->entries);
+  free(ti);
+}
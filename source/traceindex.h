@@ -0,0 +1,64 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Header: sidecar index of a trace (TRACE_PATH.idx), written along with
+  the blocks of the output stage, so that the events of an epidemic or a
+  time window can be read without scanning the whole trace.
+
+  Format: a 16 bytes header ("SIRTRIDX", version, 4 reserved bytes) and
+  one 32 bytes entry per block: offset of the block in the trace (64
+  bits), its size in the trace, number of events, first and last time
+  step, smallest and largest epidemic id (32 bits each, little endian).
+  The offsets are those of the lines or frames of plain traces, and of
+  the block headers of compressed traces.
+*/
+#ifndef TRACEINDEX_H
+#define TRACEINDEX_H
+#include <stdio.h>
+
+#define TRACEINDEX_MAGIC       "SIRTRIDX"
+#define TRACEINDEX_VERSION     1
+#define TRACEINDEX_HEADER_SIZE 16
+#define TRACEINDEX_ENTRY_SIZE  32
+#define TRACEINDEX_SUFFIX      ".idx"
+
+typedef struct _TraceIndexEntry {
+  long offset;             // in the trace
+  int length;              // bytes in the trace
+  int events;
+  int min_t, max_t;
+  int min_f, max_f;        // epidemic ids
+} TraceIndexEntry;
+
+typedef struct _TraceIndex {
+  TraceIndexEntry *entries;
+  long num_entries;
+} TraceIndex;
+
+/**
+   Opens the index of the trace at 'trace_path'. A resumed trace
+   ('append') keeps the entries of the blocks within its first
+   'trace_size' bytes; otherwise the index starts empty.
+*/
+FILE *traceindex_create(const char *trace_path, long trace_size, int append);
+void traceindex_add(FILE *idx, TraceIndexEntry *e);
+
+/**
+   Loads the index of the trace at 'trace_path'; returns NULL if there is
+   none
+*/
+TraceIndex *traceindex_load(const char *trace_path);
+
+/**
+   Keeps the entries of the blocks that may hold events of epidemic 'id'
+   (any if negative) within [from, to]; returns their number
+*/
+long traceindex_select(TraceIndex *ti, int id, int from, int to);
+void traceindex_destroy(TraceIndex *ti);
+
+#endif
@@ -0,0 +1,143 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Source: aggregate statistics of the epidemics, shared by simplesir and
+  scascade
+*/
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "tracestats.h"
+
+/**
+   Adds k to counts[i], growing the array by doubling
+*/
+static void stats_add(StatsCounts *c, int i, long k) {
+  int size = c->size? c->size : 64;
+  assert(i >= 0);
+  if (i >= c->size) {
+    while (size <= i)
+      size *= 2;
+    c->counts = (long *) realloc(c->counts, size * sizeof(long));
+    assert(c->counts != NULL);
+    memset(c->counts + c->size, 0, (size - c->size) * sizeof(long));
+    c->size = size;
+  }
+  c->counts[i] += k;
+}
+
+static long stats_count(StatsCounts *c, int i) {
+  return (i < c->size)? c->counts[i] : 0;
+}
+
+static long stats_total(StatsCounts *c) {
+  long total = 0;
+  int i;
+  for (i = 0; i < c->size; i++)
+    total += c->counts[i];
+  return total;
+}
+
+TraceStats *tracestats_new() {
+  TraceStats *ts = (TraceStats *) calloc(1, sizeof(TraceStats));
+  assert(ts != NULL);
+  ts->max_depth = 1;
+  pthread_mutex_init(&ts->lock, NULL);
+  return ts;
+}
+
+void tracestats_infection(TraceStats *ts, int t, int d) {
+  stats_add(&ts->incidence, t, 1);
+  stats_add(&ts->depths, d, 1);
+  if (d > ts->max_depth)
+    ts->max_depth = d;
+}
+
+void tracestats_event(TraceStats *ts, int t) {
+  stats_add(&ts->events, t, 1);
+}
+
+void tracestats_epidemic(TraceStats *ts, int size) {
+  stats_add(&ts->sizes, size, 1);
+  stats_add(&ts->max_depths, ts->max_depth, 1);
+  ts->max_depth = 1;
+  ts->epidemics++;
+}
+
+static void stats_merge(StatsCounts *into, StatsCounts *from) {
+  int i;
+  for (i = from->size-1; i >= 0; i--) // the largest index first: one realloc
+    if (from->counts[i])
+      stats_add(into, i, from->counts[i]);
+}
+
+void tracestats_merge(TraceStats *into, TraceStats *from) {
+  pthread_mutex_lock(&into->lock);
+  stats_merge(&into->incidence,  &from->incidence);
+  stats_merge(&into->events,     &from->events);
+  stats_merge(&into->depths,     &from->depths);
+  stats_merge(&into->max_depths, &from->max_depths);
+  stats_merge(&into->sizes,      &from->sizes);
+  into->epidemics += from->epidemics;
+  pthread_mutex_unlock(&into->lock);
+}
+
+void tracestats_write(TraceStats *ts, FILE *out) {
+  int i, n;
+  fprintf(out, "epidemics %ld\n", ts->epidemics);
+  fprintf(out, "infections %ld\n", stats_total(&ts->incidence));
+  fprintf(out, "events %ld\n", stats_total(&ts->events));
+  n = (ts->incidence.size > ts->events.size)? ts->incidence.size : ts->events.size;
+  for (i = 0; i < n; i++)
+    if (stats_count(&ts->incidence, i) || stats_count(&ts->events, i))
+      fprintf(out, "time %d %ld %ld\n", i, stats_count(&ts->incidence, i),
+	      stats_count(&ts->events, i));
+  n = (ts->depths.size > ts->max_depths.size)? ts->depths.size : ts->max_depths.size;
+  for (i = 0; i < n; i++)
+    if (stats_count(&ts->depths, i) || stats_count(&ts->max_depths, i))
+      fprintf(out, "depth %d %ld %ld\n", i, stats_count(&ts->depths, i),
+	      stats_count(&ts->max_depths, i));
+  for (i = 0; i < ts->sizes.size; i++)
+    if (ts->sizes.counts[i])
+      fprintf(out, "size %d %ld\n", i, ts->sizes.counts[i]);
+}
+
+int tracestats_read(TraceStats *ts, FILE *in) {
+  char key[16];
+  int i;
+  long x, y;
+  while (fscanf(in, "%15s %d", key, &i) == 2) {
+    if (!strcmp(key, "epidemics"))
+      ts->epidemics += i;
+    else if (!strcmp(key, "infections") || !strcmp(key, "events"))
+      ; // totals of the rows below
+    else if (!strcmp(key, "time") && fscanf(in, "%ld %ld", &x, &y) == 2) {
+      stats_add(&ts->incidence, i, x);
+      stats_add(&ts->events, i, y);
+    } else if (!strcmp(key, "depth") && fscanf(in, "%ld %ld", &x, &y) == 2) {
+      stats_add(&ts->depths, i, x);
+      stats_add(&ts->max_depths, i, y);
+    } else if (!strcmp(key, "size") && fscanf(in, "%ld", &x) == 1)
+      stats_add(&ts->sizes, i, x);
+    else
+      return 0;
+  }
+  return feof(in);
+}
+
+void tracestats_destroy(TraceStats *ts) {
+  assert(ts != NULL);
+  free(ts->incidence.counts);
+  free(ts->events.counts);
+  free(ts->depths.counts);
+  free(ts->max_depths.counts);
+  free(ts->sizes.counts);
+  pthread_mutex_destroy(&ts->lock);
+  free(ts);
+}
@@ -0,0 +1,72 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Header: aggregate statistics of the epidemics, counted online instead
+  of (or along with) the trace: incidence and trace events per time step,
+  infections per depth, final sizes and depths reached per epidemic. Each
+  thread counts on its own and the counts are merged at the end into a
+  summary of lines
+
+    epidemics N
+    infections TOTAL
+    events TOTAL
+    time T INFECTIONS EVENTS
+    depth D INFECTIONS EPIDEMICS   (epidemics whose deepest node is at D)
+    size S EPIDEMICS
+
+  where the rows with only zeros are left out.
+*/
+#ifndef TRACESTATS_H
+#define TRACESTATS_H
+#include <stdio.h>
+#include <pthread.h>
+
+typedef struct _StatsCounts {
+  long *counts;            // counts[i], 0 <= i < size
+  int size;
+} StatsCounts;
+
+typedef struct _TraceStats {
+  StatsCounts incidence;   // new infections per time step
+  StatsCounts events;      // trace events per time step
+  StatsCounts depths;      // new infections per depth
+  StatsCounts max_depths;  // epidemics per depth reached
+  StatsCounts sizes;       // epidemics per final size
+  long epidemics;
+  int max_depth;           // depth reached by the current epidemic
+  pthread_mutex_t lock;    // counts merged from several threads
+} TraceStats;
+
+TraceStats *tracestats_new();
+
+/**
+   Counts a new infection at time t and depth d (the initial nodes are at
+   depth 1), and a trace event at time t
+*/
+void tracestats_infection(TraceStats *ts, int t, int d);
+void tracestats_event(TraceStats *ts, int t);
+
+/**
+   Closes the current epidemic, of final size 'size'
+*/
+void tracestats_epidemic(TraceStats *ts, int size);
+
+/**
+   Adds the counts of 'from' (eg, of a thread) to 'into'
+*/
+void tracestats_merge(TraceStats *into, TraceStats *from);
+void tracestats_write(TraceStats *ts, FILE *out);
+
+/**
+   Adds the counts of a summary written by tracestats_write (eg, by
+   another process); returns 0 if it is malformed
+*/
+int tracestats_read(TraceStats *ts, FILE *in);
+void tracestats_destroy(TraceStats *ts);
+
+#endif
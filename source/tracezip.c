@@ -0,0 +1,262 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Source: block compressed traces (zlib)
+*/
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "tracezip.h"
+
+#define TRACEZIP_BLOCK_MAGIC "ZBLK"
+#define TRACEZIP_INDEX_TAG   "ZIDX"
+#define TRACEZIP_ENTRY_SIZE  32
+#define TRACEZIP_TRAILER     20
+
+static void zput32(unsigned char *buf, unsigned int x) {
+  buf[0] = x & 0xff; buf[1] = (x >> 8) & 0xff;
+  buf[2] = (x >> 16) & 0xff; buf[3] = (x >> 24) & 0xff;
+}
+
+static unsigned int zget32(const unsigned char *buf) {
+  return (unsigned int)buf[0] | ((unsigned int)buf[1] << 8) |
+    ((unsigned int)buf[2] << 16) | ((unsigned int)buf[3] << 24);
+}
+
+static void zput64(unsigned char *buf, long x) {
+  zput32(buf,   (unsigned int)((unsigned long) x & 0xffffffffu));
+  zput32(buf+4, (unsigned int)((unsigned long) x >> 32));
+}
+
+void tracezip_header(FILE *out) {
+  unsigned char header[TRACEZIP_HEADER_SIZE];
+  memcpy(header, TRACEZIP_MAGIC, 8);
+  header[8]  = TRACEZIP_VERSION;
+  header[9]  = TRACEZIP_DEFLATE;
+  header[10] = header[11] = 0;
+  fwrite(header, 1, TRACEZIP_HEADER_SIZE, out);
+}
+
+long tracezip_bound(int raw_length) {
+  return TRACEZIP_BLOCK_HEADER + (long) compressBound((uLong) raw_length);
+}
+
+int tracezip_block(unsigned char *dst, const unsigned char *raw, int raw_length,
+		   int min_t, int max_t, int level) {
+  uLongf len = (uLongf) compressBound((uLong) raw_length);
+  int err = compress2(dst + TRACEZIP_BLOCK_HEADER, &len, raw, (uLong) raw_length, level);
+  assert(err == Z_OK);
+  memcpy(dst, TRACEZIP_BLOCK_MAGIC, 4);
+  zput32(dst+4,  (unsigned int) len);
+  zput32(dst+8,  (unsigned int) raw_length);
+  zput32(dst+12, (unsigned int) min_t);
+  zput32(dst+16, (unsigned int) max_t);
+  return TRACEZIP_BLOCK_HEADER + (int) len;
+}
+
+void tracezip_index_init(TraceZipIndex *idx) {
+  idx->entries    = NULL;
+  idx->num_blocks = idx->capacity = 0;
+  idx->raw_size   = 0;
+}
+
+void tracezip_index_add(TraceZipIndex *idx, long offset, int length, int raw_length,
+			int min_t, int max_t) {
+  TraceZipEntry *e;
+  if (idx->num_blocks == idx->capacity) {
+    idx->capacity = idx->capacity? 2*idx->capacity : 256;
+    idx->entries = (TraceZipEntry *) realloc(idx->entries, idx->capacity * sizeof(TraceZipEntry));
+    assert(idx->entries != NULL);
+  }
+  e = idx->entries + idx->num_blocks++;
+  e->offset     = offset;
+  e->raw_offset = idx->raw_size;
+  e->length     = length;
+  e->raw_length = raw_length;
+  e->min_t      = min_t;
+  e->max_t      = max_t;
+  idx->raw_size += raw_length;
+}
+
+void tracezip_index_write(TraceZipIndex *idx, FILE *out, long offset) {
+  unsigned char buf[TRACEZIP_ENTRY_SIZE];
+  long i;
+  TraceZipEntry *e;
+
+  fwrite(TRACEZIP_INDEX_TAG, 1, 4, out);
+  for (i = 0; i < idx->num_blocks; i++) {
+    e = idx->entries + i;
+    zput64(buf,    e->offset);
+    zput64(buf+8,  e->raw_offset);
+    zput32(buf+16, (unsigned int) e->length);
+    zput32(buf+20, (unsigned int) e->raw_length);
+    zput32(buf+24, (unsigned int) e->min_t);
+    zput32(buf+28, (unsigned int) e->max_t);
+    fwrite(buf, 1, TRACEZIP_ENTRY_SIZE, out);
+  }
+  zput64(buf, offset);
+  zput32(buf+8, (unsigned int) idx->num_blocks);
+  memcpy(buf+12, TRACEZIP_INDEX_MAGIC, 8);
+  fwrite(buf, 1, TRACEZIP_TRAILER, out);
+}
+
+void tracezip_index_free(TraceZipIndex *idx) {
+  free(idx->entries);
+  tracezip_index_init(idx);
+}
+
+void tracezip_index_scan(TraceZipIndex *idx, FILE *out) {
+  unsigned char header[TRACEZIP_BLOCK_HEADER];
+  long offset = TRACEZIP_HEADER_SIZE;
+  int length;
+
+  tracezip_index_init(idx);
+  fflush(out);
+  fseek(out, offset, SEEK_SET);
+  while (fread(header, 1, TRACEZIP_BLOCK_HEADER, out) == TRACEZIP_BLOCK_HEADER &&
+	 !memcmp(header, TRACEZIP_BLOCK_MAGIC, 4)) {
+    length = (int) zget32(header+4);
+    tracezip_index_add(idx, offset, length, (int) zget32(header+8),
+		       (int) zget32(header+12), (int) zget32(header+16));
+    offset += TRACEZIP_BLOCK_HEADER + length;
+    fseek(out, offset, SEEK_SET);
+  }
+  fflush(out);
+  if (ftruncate(fileno(out), offset) != 0) // drops an index left after the blocks
+    perror("tracezip_index_scan: ftruncate");
+  fseek(out, offset, SEEK_SET);
+}
+
+TraceZip *tracezip_open(FILE *in, int threads) {
+  TraceZip *z = (TraceZip *) calloc(1, sizeof(TraceZip));
+  assert(z != NULL && in != NULL && threads > 0 && threads <= TRACEZIP_THREADS);
+  z->in      = in;
+  z->from    = INT_MIN;
+  z->to      = INT_MAX;
+  z->threads = threads;
+  z->batch   = (TraceZipBlock *) calloc(threads, sizeof(TraceZipBlock));
+  assert(z->batch != NULL);
+  return z;
+}
+
+void tracezip_window(TraceZip *z, int from, int to) {
+  z->from = from;
+  z->to   = to;
+}
+
+void tracezip_blocks(TraceZip *z, const long *offsets, long n) {
+  z->offsets     = offsets;
+  z->num_offsets = n;
+  z->next_offset = 0;
+  z->batch_size  = z->next = 0; // drops the blocks read ahead
+  z->eof = 0;
+}
+
+static void *tracezip_inflate(void *arg) {
+  TraceZipBlock *b = (TraceZipBlock *) arg;
+  uLongf len = (uLongf) b->raw_length;
+  if (b->raw_length > b->raw_capacity) {
+    b->raw_capacity = b->raw_length;
+    b->raw = (unsigned char *) realloc(b->raw, b->raw_capacity);
+    assert(b->raw != NULL);
+  }
+  b->ok = uncompress(b->raw, &len, b->data, (uLong) b->length) == Z_OK &&
+    len == (uLongf) b->raw_length;
+  return NULL;
+}
+
+/**
+   Reads the next blocks of the window, up to one per thread, and
+   decompresses them together
+*/
+static int tracezip_batch(TraceZip *z) {
+  unsigned char header[TRACEZIP_BLOCK_HEADER];
+  pthread_t threads[TRACEZIP_THREADS];
+  TraceZipBlock *b;
+  int i, n = 0, length, min_t, max_t;
+
+  while (n < z->threads && !z->eof) {
+    if (z->offsets && (z->next_offset == z->num_offsets ||
+		       fseek(z->in, z->offsets[z->next_offset++], SEEK_SET) != 0)) {
+      z->eof = 1;
+      break;
+    }
+    if (fread(header, 1, TRACEZIP_BLOCK_HEADER, z->in) != TRACEZIP_BLOCK_HEADER ||
+	memcmp(header, TRACEZIP_BLOCK_MAGIC, 4)) {
+      z->eof = 1; // end of the blocks (or index)
+      break;
+    }
+    length = (int) zget32(header+4);
+    min_t  = (int) zget32(header+12);
+    max_t  = (int) zget32(header+16);
+    b = z->batch + n;
+    if (length > b->capacity) {
+      b->capacity = length;
+      b->data = (unsigned char *) realloc(b->data, b->capacity);
+      assert(b->data != NULL);
+    }
+    if (max_t < z->from || min_t > z->to) { // outside the window
+      if (fseek(z->in, length, SEEK_CUR) != 0 &&
+	  fread(b->data, 1, length, z->in) != (size_t) length)
+	z->eof = 1;
+      z->skipped++;
+      continue;
+    }
+    if (fread(b->data, 1, length, z->in) != (size_t) length) {
+      fprintf(stderr, "Truncated compressed block.\n");
+      z->eof = 1;
+      break;
+    }
+    b->length     = length;
+    b->raw_length = (int) zget32(header+8);
+    n++;
+  }
+  for (i = 1; i < n; i++)
+    if (pthread_create(threads+i, NULL, tracezip_inflate, z->batch+i) != 0) {
+      perror("tracezip_batch: pthread_create");
+      exit(-1);
+    }
+  if (n > 0)
+    tracezip_inflate(z->batch);
+  for (i = 1; i < n; i++)
+    pthread_join(threads[i], NULL);
+  for (i = 0; i < n; i++)
+    if (!z->batch[i].ok) {
+      fprintf(stderr, "Corrupted compressed block.\n");
+      n = i;
+      z->eof = 1;
+    }
+  z->batch_size = n;
+  z->next = 0;
+  return n;
+}
+
+int tracezip_next(TraceZip *z, unsigned char **raw, int *raw_length) {
+  if (z->next == z->batch_size && !tracezip_batch(z))
+    return 0;
+  *raw        = z->batch[z->next].raw;
+  *raw_length = z->batch[z->next].raw_length;
+  z->next++;
+  return 1;
+}
+
+void tracezip_close(TraceZip *z) {
+  int i;
+  assert(z != NULL);
+  for (i = 0; i < z->threads; i++) {
+    free(z->batch[i].data);
+    free(z->batch[i].raw);
+  }
+  free(z->batch);
+  free(z);
+}
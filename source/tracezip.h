@@ -0,0 +1,117 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, winter 2012/13
+
+  Header: block compressed traces. The container holds a text or binary
+  trace cut into independently deflated blocks (zlib), each made of whole
+  lines or frames:
+
+    file header  "SIRTRACZ", version, codec, 2 reserved bytes (12 bytes)
+    blocks       "ZBLK", compressed length, raw length, min t, max t
+                 (20 bytes), then the compressed bytes
+    index        "ZIDX", then per block: file offset and raw offset (64
+                 bits), compressed length, raw length, min t, max t
+    trailer      index offset (64 bits), number of blocks, "SIRZINDX"
+
+  All integers are little endian. The blocks alone describe the file (the
+  index is only written when the trace is complete), so a reader can
+  stream them, skip the blocks outside a time window, and decompress
+  several blocks in parallel.
+*/
+#ifndef TRACEZIP_H
+#define TRACEZIP_H
+#include <stdio.h>
+
+#define TRACEZIP_MAGIC        "SIRTRACZ"
+#define TRACEZIP_INDEX_MAGIC  "SIRZINDX"
+#define TRACEZIP_VERSION      1
+#define TRACEZIP_DEFLATE      1
+#define TRACEZIP_HEADER_SIZE  12
+#define TRACEZIP_BLOCK_HEADER 20
+#define TRACEZIP_LEVEL        6   // zlib compression level
+#define TRACEZIP_THREADS      8   // max blocks (de)compressed at once
+
+typedef struct _TraceZipEntry {
+  long offset;             // file offset of the block header
+  long raw_offset;         // offset of the block in the uncompressed trace
+  int length;              // compressed length
+  int raw_length;
+  int min_t, max_t;        // time range of the events of the block
+} TraceZipEntry;
+
+typedef struct _TraceZipIndex {
+  TraceZipEntry *entries;
+  long num_blocks, capacity;
+  long raw_size;           // size of the uncompressed trace
+} TraceZipIndex;
+
+typedef struct _TraceZipBlock {
+  int length, raw_length;
+  unsigned char *data;     // compressed bytes
+  int capacity;
+  unsigned char *raw;      // decompressed bytes
+  int raw_capacity;
+  int ok;
+} TraceZipBlock;
+
+typedef struct _TraceZip {
+  FILE *in;
+  int from, to;            // time window of the blocks to read
+  int threads;
+  TraceZipBlock *batch;    // blocks decompressed together
+  int batch_size, next;
+  long skipped;            // blocks outside the window
+  const long *offsets;     // blocks to read (see tracezip_blocks), or NULL
+  long num_offsets, next_offset;
+  int eof;
+} TraceZip;
+
+/**
+   Writes the header of a compressed trace
+*/
+void tracezip_header(FILE *out);
+
+/**
+   Compresses 'raw' into 'dst' as a block (header included), with room
+   for tracezip_bound(raw_length) bytes; returns the size of the block
+*/
+long tracezip_bound(int raw_length);
+int tracezip_block(unsigned char *dst, const unsigned char *raw, int raw_length,
+		   int min_t, int max_t, int level);
+
+/**
+   Index of the blocks being written; the index is written at 'offset',
+   the size of the output so far (which may be a pipe)
+*/
+void tracezip_index_init(TraceZipIndex *idx);
+void tracezip_index_add(TraceZipIndex *idx, long offset, int length, int raw_length,
+			int min_t, int max_t);
+void tracezip_index_write(TraceZipIndex *idx, FILE *out, long offset);
+void tracezip_index_free(TraceZipIndex *idx);
+
+/**
+   Rebuilds the index of a compressed trace reopened for appending (eg,
+   on resume), by scanning its block headers from the start
+*/
+void tracezip_index_scan(TraceZipIndex *idx, FILE *out);
+
+/**
+   Reads the blocks of a compressed trace whose header was already read;
+   tracezip_next returns the next decompressed block (0 at the end)
+*/
+TraceZip *tracezip_open(FILE *in, int threads);
+void tracezip_window(TraceZip *z, int from, int to);
+
+/**
+   Reads only the 'n' blocks whose headers are at 'offsets' (eg, from a
+   sidecar index), instead of the rest of the file
+*/
+void tracezip_blocks(TraceZip *z, const long *offsets, long n);
+int tracezip_next(TraceZip *z, unsigned char **raw, int *raw_length);
+void tracezip_close(TraceZip *z);
+
+#endif
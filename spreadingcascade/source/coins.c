@@ -0,0 +1,43 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  Counter-based random draws: the coin of an arc (or edge) in a given
+  sample is a pure function of (sample seed, arc endpoints), so that a
+  realization of the spreading can be shared by several threads or
+  re-derived on demand without keeping any generator state.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+*/
+
+#include <stdint.h>
+
+/**
+   SplitMix64 finalizer: bijective 64 bits mixing
+*/
+inline uint64_t coin_mix(uint64_t x) {
+  x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+/**
+   Uniform draw in [0,1[ attached to 'key' in the sample 'seed'
+*/
+inline double coin_urand(uint64_t seed, uint64_t key) {
+  return (double)(coin_mix(seed ^ coin_mix(key)) >> 11) * (1.0/9007199254740992.0);
+}
+
+/**
+   Returns a fresh 64 bits sample seed from the global generator
+*/
+uint64_t coin_seed() {
+  return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+}
+
+/**
+   Key of the arc u -> v: derived from its endpoints, so that the coin of
+   an arc can also be drawn when it is reached backwards, from v
+*/
+inline uint64_t coin_link(int u, int v) {
+  return ((uint64_t)(uint32_t)u << 32) | (uint64_t)(uint32_t)v;
+}
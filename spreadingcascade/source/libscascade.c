@@ -0,0 +1,249 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+
+  The simulation engine of scascade as a library, see scascade.h: the
+  engine is scascade.c itself, without its main
+*/
+
+#define SCASCADE_LIBRARY
+#include "scascade.c"
+#include "scascade.h"
+
+struct _ScascadeGraph {
+  graph *g;
+  double growth;          // graph_growth(g, 1): times p, that of a run
+};
+
+struct _ScascadeEpidemics {
+  InitialCondition *ic;
+  int count, capacity;
+  int *seeds;             // of all the epidemics, in order (the arena of ic)
+  long num_seeds, max_seeds;
+  Stopc stop_criterion;
+};
+
+// the events are handed over as they are
+typedef char scascade_event_layout[(sizeof(ScascadeEvent) == sizeof(TraceEvent))? 1 : -1];
+
+static ScascadeGraph *scascade_graph(graph *g) {
+  ScascadeGraph *sg = (ScascadeGraph *) malloc(sizeof(ScascadeGraph));
+  assert(sg != NULL);
+  sg->g      = g;
+  sg->growth = graph_growth(g, 1.0);
+  return sg;
+}
+
+ScascadeGraph *scascade_graph_load(const char *path) {
+  graph *g;
+  FILE *in = fopen(path, "r");
+  if (in == NULL)
+    return NULL;
+  g = graph_from_file(in);
+  fclose(in);
+  return scascade_graph(g);
+}
+
+ScascadeGraph *scascade_graph_new(int n, int m, const int *links) {
+  int i, u, v;
+  graph *g;
+
+  assert(n >= 0 && m >= 0 && (m == 0 || links != NULL));
+  for (i = 0; i < 2*m; i++)
+    if (links[i] < 0 || links[i] >= n)
+      return NULL;
+  g = (graph *) malloc(sizeof(graph));
+  assert(g != NULL);
+  g->n = n;
+  g->m = m;
+  g->degrees    = (int *) calloc(n + 1, sizeof(int));
+  g->capacities = (int *) calloc(n + 1, sizeof(int));
+  g->links      = (int **) malloc((n + 1) * sizeof(int *));
+  assert(g->degrees != NULL && g->capacities != NULL && g->links != NULL);
+  g->links[0]   = (int *) malloc((2L*m + 1) * sizeof(int));
+  assert(g->links[0] != NULL);
+  for (i = 0; i < 2*m; i++)
+    g->capacities[links[i]]++;
+  for (u = 1; u < n; u++)
+    g->links[u] = g->links[u-1] + g->capacities[u-1];
+  for (i = 0; i < m; i++) { // as graph_from_file does
+    u = links[2*i];
+    v = links[2*i+1];
+    g->links[u][g->degrees[u]++] = v;
+    g->links[v][g->degrees[v]++] = u;
+  }
+  return scascade_graph(g);
+}
+
+int scascade_graph_nodes(const ScascadeGraph *g) {
+  return g->g->n;
+}
+
+int scascade_graph_links(const ScascadeGraph *g) {
+  return g->g->m;
+}
+
+void scascade_graph_free(ScascadeGraph *g) {
+  if (g) {
+    free_graph(g->g);
+    free(g);
+  }
+}
+
+ScascadeEpidemics *scascade_epidemics_new(ScascadeBound bound) {
+  ScascadeEpidemics *e = (ScascadeEpidemics *) calloc(1, sizeof(ScascadeEpidemics));
+  assert(e != NULL);
+  e->stop_criterion = (bound == SCASCADE_MAX_SIZE)? NumInfected : MaxTime;
+  return e;
+}
+
+void scascade_epidemics_add(ScascadeEpidemics *e, int id, const int *seeds, int num_seeds,
+			    int limit) {
+  int i;
+  long offset;
+  InitialCondition *ic;
+
+  assert(e != NULL && seeds != NULL && num_seeds > 0);
+  if (e->count == e->capacity) {
+    e->capacity = e->capacity? 2*e->capacity : 64;
+    e->ic = (InitialCondition *) realloc(e->ic, e->capacity * sizeof(InitialCondition));
+    assert(e->ic != NULL);
+  }
+  if (e->num_seeds + num_seeds > e->max_seeds) {
+    while (e->num_seeds + num_seeds > e->max_seeds)
+      e->max_seeds = e->max_seeds? 2*e->max_seeds : 1024;
+    e->seeds = (int *) realloc(e->seeds, e->max_seeds * sizeof(int));
+    assert(e->seeds != NULL);
+    for (i = 0, offset = 0; i < e->count; offset += e->ic[i++].num_infected)
+      e->ic[i].infected = e->seeds + offset; // the arena moved
+  }
+  ic = e->ic + e->count++;
+  ic->id             = id;
+  ic->num_infected   = num_seeds;
+  ic->infected       = e->seeds + e->num_seeds;
+  ic->bound          = limit;
+  ic->stop_criterion = e->stop_criterion;
+  memcpy(ic->infected, seeds, num_seeds * sizeof(int));
+  e->num_seeds += num_seeds;
+}
+
+ScascadeEpidemics *scascade_epidemics_load(const char *initial_path, const char *bounds_path,
+					   ScascadeBound bound, int limit) {
+  int i;
+  FILE *in, *bounds = NULL;
+  ScascadeEpidemics *e;
+
+  if ((in = fopen(initial_path, "r")) == NULL)
+    return NULL;
+  if (bounds_path && (bounds = fopen(bounds_path, "r")) == NULL) {
+    fclose(in);
+    return NULL;
+  }
+  e = scascade_epidemics_new(bound);
+  e->count = e->capacity = ic_import(&e->ic, in, 0);
+  fclose(in);
+  e->seeds = e->ic->infected; // ic_arena: one block, in order
+  for (i = 0; i < e->count; i++) {
+    e->num_seeds += e->ic[i].num_infected;
+    e->ic[i].bound          = limit;
+    e->ic[i].stop_criterion = e->stop_criterion;
+  }
+  e->max_seeds = e->num_seeds;
+  if (bounds) {
+    ic_import_bounds(e->ic, e->count, e->stop_criterion, bounds);
+    fclose(bounds);
+  }
+  return e;
+}
+
+ScascadeEpidemics *scascade_epidemics_random(const ScascadeGraph *g, int count,
+					     ScascadeBound bound, int limit) {
+  int i, seed;
+  ScascadeEpidemics *e = scascade_epidemics_new(bound);
+  assert(g->g->n > 0);
+  for (i = 0; i < count; i++) { // as ic_random_epidemics
+    seed = rand() % g->g->n;
+    scascade_epidemics_add(e, i, &seed, 1, limit);
+  }
+  return e;
+}
+
+int scascade_epidemics_count(const ScascadeEpidemics *e) {
+  return e->count;
+}
+
+void scascade_epidemics_free(ScascadeEpidemics *e) {
+  if (e) {
+    free(e->seeds);
+    free(e->ic);
+    free(e);
+  }
+}
+
+void scascade_config_init(ScascadeConfig *config) {
+  config->p           = 0.0;
+  config->samples     = 1;
+  config->threads     = 1;
+  config->interleave  = 1;
+  config->trace_rate  = 1.0;
+  config->step_events = 0;
+  config->seed        = 0;
+  config->verbose     = 0;
+}
+
+static void scascade_result(void *user, const ResultRow *row) {
+  const ScascadeSinks *sinks = (const ScascadeSinks *) user;
+  ScascadeResult result;
+  result.id            = row->id;
+  result.sample        = row->sample;
+  result.seeds         = row->seeds;
+  result.bound         = row->bound;
+  result.size          = row->size;
+  result.max_depth     = row->max_depth;
+  result.cascade_links = row->cascade_links;
+  result.end_time      = row->end_time;
+  result.wall_time     = row->wall_time;
+  sinks->result(sinks->user, &result);
+}
+
+static void scascade_trace(void *user, const TraceEvent *events, int count) {
+  const ScascadeSinks *sinks = (const ScascadeSinks *) user;
+  sinks->trace(sinks->user, (const ScascadeEvent *) events, count);
+}
+
+int scascade_run(const ScascadeGraph *g, const ScascadeEpidemics *e,
+		 const ScascadeConfig *config, const ScascadeSinks *sinks) {
+  int i, j;
+  EpidemicTasks tasks;
+  ResultsTable *results = NULL;
+
+  if (!g || !e || !config || config->p < 0.0 || config->p > 1.0 || config->samples <= 0 ||
+      config->threads <= 0 || config->interleave <= 0 || config->trace_rate <= 0.0 ||
+      config->trace_rate > 1.0 || config->step_events < 0)
+    return -1;
+  for (i = 0; i < e->count; i++)
+    for (j = 0; j < e->ic[i].num_infected; j++)
+      if (e->ic[i].infected[j] < 0 || e->ic[i].infected[j] >= g->g->n)
+	return -1;
+  if (e->count == 0)
+    return 0;
+
+  if (config->seed)
+    srand(config->seed);
+  if (sinks && sinks->result)
+    results = results_callback(scascade_result, (void *) sinks);
+  tasks_init(&tasks, config->threads, config->p * g->growth, g->g, e->ic, e->count, NULL, 0,
+	     e->stop_criterion);
+  tasks.verbose = config->verbose; // of this run only
+  simulate_run(&tasks, config->p, g->g, config->samples, config->interleave, NULL, NULL,
+	       (sinks && sinks->trace)? scascade_trace : NULL, (void *) sinks,
+	       config->trace_rate, config->step_events, NULL, results, NULL, NULL);
+  tasks_clean(&tasks);
+  if (results)
+    results_destroy(results);
+  return e->count;
+}
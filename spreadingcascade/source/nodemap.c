@@ -0,0 +1,160 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  Adaptive map of node ids to positive values (the infection times of an
+  epidemic): an open addressing hash while the cascade is small, so that
+  an epidemic costs the nodes it touches and not the size of the graph,
+  promoted to a dense array of n values once the hash would take more
+  than a fraction of it.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+*/
+
+#include <stdlib.h>
+#include <assert.h>
+
+#define NODEMAP_MIN   64  // initial slots of the hash
+#define NODEMAP_DENSE 8   // dense once the hash needs n / NODEMAP_DENSE slots
+
+typedef struct _NodeMap {
+  int n;                  // number of nodes
+  int size;               // number of nodes in the map
+  int capacity;           // slots of the hash (a power of 2), 0 when dense
+  int shift;              // 32 - log2(capacity)
+  int *keys;              // hash: node ids, -1 for a free slot
+  int *values;            // hash: their values; dense: the value of each node
+} NodeMap;
+
+/**
+   Fibonacci hashing: the top bits of the product
+*/
+inline unsigned int nodemap_slot(NodeMap *m, int u) {
+  return ((unsigned int) u * 2654435769u) >> m->shift;
+}
+
+static void nodemap_alloc(NodeMap *m, int capacity) {
+  int i;
+  m->capacity = capacity;
+  for (m->shift = 32; capacity > 1; capacity >>= 1)
+    m->shift--;
+  m->keys   = (int *) malloc(m->capacity * sizeof(int));
+  m->values = (int *) malloc(m->capacity * sizeof(int));
+  assert(m->keys != NULL && m->values != NULL);
+  for (i = 0; i < m->capacity; i++)
+    m->keys[i] = -1;
+}
+
+NodeMap *nodemap_new(int n) {
+  NodeMap *m = (NodeMap *) malloc(sizeof(NodeMap));
+  assert(m != NULL && n > 0);
+  m->n    = n;
+  m->size = 0;
+  if (NODEMAP_MIN >= n / NODEMAP_DENSE) { // small graph: dense at once
+    m->capacity = 0;
+    m->keys     = NULL;
+    m->values   = (int *) calloc(n, sizeof(int));
+    assert(m->values != NULL);
+  } else
+    nodemap_alloc(m, NODEMAP_MIN);
+  return m;
+}
+
+void nodemap_destroy(NodeMap *m) {
+  assert(m != NULL);
+  free(m->keys);
+  free(m->values);
+  free(m);
+}
+
+/**
+   Value of node u, 0 if absent
+*/
+inline int nodemap_get(NodeMap *m, int u) {
+  unsigned int i;
+  if (!m->capacity)
+    return m->values[u];
+  for (i = nodemap_slot(m, u); m->keys[i] != -1; i = (i+1) & (m->capacity-1))
+    if (m->keys[i] == u)
+      return m->values[i];
+  return 0;
+}
+
+/**
+   Prefetches the slot of node u, for a nodemap_get shortly after
+*/
+inline void nodemap_prefetch(NodeMap *m, int u) {
+  unsigned int i;
+  if (!m->capacity) {
+    __builtin_prefetch(m->values + u);
+    return;
+  }
+  i = nodemap_slot(m, u);
+  __builtin_prefetch(m->keys + i);
+  __builtin_prefetch(m->values + i);
+}
+
+/**
+   Moves the map to the dense array, eg, so that several threads can set
+   values with atomic operations
+*/
+void nodemap_dense(NodeMap *m) {
+  int i, *keys = m->keys, *values = m->values;
+  if (!m->capacity)
+    return;
+  m->values = (int *) calloc(m->n, sizeof(int));
+  assert(m->values != NULL);
+  for (i = 0; i < m->capacity; i++)
+    if (keys[i] != -1)
+      m->values[keys[i]] = values[i];
+  m->capacity = 0;
+  m->keys     = NULL;
+  free(keys);
+  free(values);
+}
+
+/**
+   Doubles the hash, or moves to the dense array
+*/
+static void nodemap_grow(NodeMap *m) {
+  int i, capacity = m->capacity, *keys = m->keys, *values = m->values;
+  unsigned int j;
+  if (2*capacity >= m->n / NODEMAP_DENSE) {
+    nodemap_dense(m);
+    return;
+  }
+  nodemap_alloc(m, 2*capacity);
+  for (i = 0; i < capacity; i++)
+    if (keys[i] != -1) {
+      for (j = nodemap_slot(m, keys[i]); m->keys[j] != -1; j = (j+1) & (m->capacity-1))
+	;
+      m->keys[j]   = keys[i];
+      m->values[j] = values[i];
+    }
+  free(keys);
+  free(values);
+}
+
+/**
+   Sets the value (positive) of node u
+*/
+inline void nodemap_set(NodeMap *m, int u, int value) {
+  unsigned int i;
+  assert(value > 0 && u >= 0 && u < m->n);
+  if (!m->capacity) {
+    m->size += !m->values[u];
+    m->values[u] = value;
+    return;
+  }
+  for (i = nodemap_slot(m, u); m->keys[i] != -1; i = (i+1) & (m->capacity-1))
+    if (m->keys[i] == u) {
+      m->values[i] = value;
+      return;
+    }
+  if (2*(m->size+1) > m->capacity) { // at most half full
+    nodemap_grow(m);
+    nodemap_set(m, u, value);
+    return;
+  }
+  m->keys[i]   = u;
+  m->values[i] = value;
+  m->size++;
+}
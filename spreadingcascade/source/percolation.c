@@ -0,0 +1,104 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  Final-size engine by bond percolation. Without time bounds, an
+  independent cascade in which each arc is tried at most once reaches
+  exactly the union of the seeds' components in a graph where each edge
+  is kept with probability p. One percolated sample answers the final
+  size of every initial condition at once.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+*/
+
+typedef struct _Percolation {
+  int n;                  // number of nodes
+  int *parent;            // union-find forest (parent[u] <= u)
+  int *size;              // component sizes, valid at the roots
+} Percolation;
+
+Percolation *percolation_new(graph *g) {
+  Percolation *perc = (Percolation *) malloc(sizeof(Percolation));
+  assert(perc != NULL);
+  perc->n      = g->n;
+  perc->parent = (int *) malloc(g->n * sizeof(int));
+  perc->size   = (int *) malloc(g->n * sizeof(int));
+  assert(perc->parent != NULL && perc->size != NULL);
+  return perc;
+}
+
+void percolation_destroy(Percolation *perc) {
+  assert(perc != NULL);
+  free(perc->parent);
+  free(perc->size);
+  free(perc);
+}
+
+/**
+   Lock-free find with path halving: pointers only move up to ancestors,
+   which always have smaller ids, so concurrent finds and unions are safe
+*/
+int percolation_find(Percolation *perc, int u) {
+  volatile int *parent = perc->parent;
+  int p, gp;
+  while ((p = parent[u]) != u) {
+    gp = parent[p];
+    if (p != gp)
+      __sync_bool_compare_and_swap(&perc->parent[u], p, gp);
+    u = p;
+  }
+  return u;
+}
+
+void percolation_union(Percolation *perc, int u, int v) {
+  int tmp;
+  for (;;) {
+    u = percolation_find(perc, u);
+    v = percolation_find(perc, v);
+    if (u == v)
+      return;
+    if (u < v) { tmp = u; u = v; v = tmp; } // link the larger root below
+    if (__sync_bool_compare_and_swap(&perc->parent[u], u, v))
+      return;
+  }
+}
+
+/**
+   Draws one percolated graph, keeping each edge {u,v} with probability p,
+   and computes its component sizes
+*/
+void percolation_sample(Percolation *perc, graph *g, double p, uint64_t seed) {
+  int u, i, v;
+
+  #pragma omp parallel for schedule(static)
+  for (u = 0; u < g->n; u++) {
+    perc->parent[u] = u;
+    perc->size[u]   = 0;
+  }
+
+  #pragma omp parallel for private(i,v) schedule(guided)
+  for (u = 0; u < g->n; u++)
+    for (i = 0; i < g->degrees[u]; i++) {
+      v = g->links[u][i];
+      if (u < v && coin_urand(seed, coin_link(u, v)) < p)
+	percolation_union(perc, u, v);
+    }
+
+  #pragma omp parallel for schedule(static)
+  for (u = 0; u < g->n; u++)
+    __sync_fetch_and_add(&perc->size[percolation_find(perc, u)], 1);
+}
+
+/**
+   Final size of the cascade started by the k nodes in 'seeds'
+*/
+int percolation_final_size(Percolation *perc, int *seeds, int k) {
+  int i, j, r, total = 0;
+  for (i = 0; i < k; i++) {
+    r = percolation_find(perc, seeds[i]);
+    for (j = 0; j < i; j++) // seed sets are small: quadratic dedup
+      if (percolation_find(perc, seeds[j]) == r)
+	break;
+    if (j == i)
+      total += perc->size[r];
+  }
+  return total;
+}
@@ -10,6 +10,7 @@ typedef struct _Queue {
 
 inline int queue_empty(Queue *q){ return (q->begin == q->end); }
 inline int queue_full(Queue *q) { return (q->begin == (q->end+1) % q->size); }
+inline int queue_length(Queue *q) { return (q->end - q->begin + q->size) % q->size; }
 
 Queue *queue_new(int size) {
   Queue *q = (Queue *) malloc(sizeof(Queue));
@@ -28,8 +29,24 @@ void queue_destroy(Queue *q) {
   q = NULL;
 }
 
+/**
+   Doubles the queue, its elements moved to the start in order
+*/
+void queue_grow(Queue *q) {
+  int i, n = 0, *nodes = (int *) malloc(2 * q->size * sizeof(int));
+  assert(nodes != NULL);
+  for (i = q->begin; i != q->end; i = (i+1) % q->size)
+    nodes[n++] = q->nodes[i];
+  free(q->nodes);
+  q->nodes = nodes;
+  q->size *= 2;
+  q->begin = 0;
+  q->end = n;
+}
+
 void queue_add(Queue *q, int e) {
-  assert( !queue_full(q) );
+  if (queue_full(q)) // sized for the elements it holds, not for all of them
+    queue_grow(q);
   q->nodes[q->end] = e;
   q->end++;
   q->end %= q->size;
@@ -44,4 +61,12 @@ int queue_get(Queue *q) {
   return r;
 }
 
+/**
+   k-th element from the start, left in the queue
+*/
+inline int queue_peek(Queue *q, int k) {
+  assert(k >= 0 && k < queue_length(q));
+  return q->nodes[(q->begin+k) % q->size];
+}
+
 // int main() { return 0; }
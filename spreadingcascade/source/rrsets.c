@@ -0,0 +1,170 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  Reverse-reachable (RR) sets for influence estimation and seed
+  selection. An RR set holds the nodes that would infect a random root
+  within the time bound, in one sample of live arcs (reverse BFS from the
+  root). A seed set hits a random RR set with probability equal to its
+  expected spread divided by n, so a greedy maximum coverage over many
+  RR sets picks seeds without any forward simulation.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+*/
+
+typedef struct _RRSets {
+  int n;                  // number of nodes
+  long num_sets;          // number of RR sets
+  long *offsets;          // set i: nodes[offsets[i]] ... nodes[offsets[i+1]-1]
+  int *nodes;             // flat arena of the nodes of all sets
+} RRSets;
+
+void rrsets_destroy(RRSets *rr) {
+  assert(rr != NULL);
+  free(rr->offsets);
+  free(rr->nodes);
+  free(rr);
+}
+
+/**
+   Samples 'num_sets' RR sets by reverse BFS up to depth 'bound' (no bound
+   if bound <= 0), each set with its own sample of live arcs; every thread
+   fills a private arena, and the arenas are then concatenated in set
+   order, so the result does not depend on the number of threads
+*/
+RRSets *rrsets_sample(graph *g, double p, int bound, long num_sets, uint64_t seed) {
+  long i, *thread_size = NULL;
+  int t, nthreads = 1;
+  RRSets *rr = (RRSets *) malloc(sizeof(RRSets));
+  assert(rr != NULL);
+  rr->n        = g->n;
+  rr->num_sets = num_sets;
+  rr->offsets  = (long *) malloc((num_sets+1) * sizeof(long));
+  assert(rr->offsets != NULL);
+  rr->offsets[0] = 0;
+
+  #pragma omp parallel private(i,t)
+  {
+    int j, x, y, head, tail, mark = 0, tid = omp_get_thread_num();
+    int *visited = (int *) calloc(g->n, sizeof(int));
+    int *queue   = (int *) malloc(g->n * sizeof(int));
+    int *depth   = (int *) malloc(g->n * sizeof(int));
+    long size = 0, capacity = 1024;
+    int *arena = (int *) malloc(capacity * sizeof(int));
+    uint64_t set_seed;
+    assert(visited && queue && depth && arena);
+
+    #pragma omp single
+    {
+      nthreads    = omp_get_num_threads();
+      thread_size = (long *) calloc(nthreads+1, sizeof(long));
+      assert(thread_size != NULL);
+    }
+
+    #pragma omp for schedule(static)
+    for (i = 0; i < num_sets; i++) {
+      set_seed = coin_mix(seed + (uint64_t)i);
+      mark++;
+      queue[0] = (int) (coin_mix(set_seed) % (uint64_t)g->n); // root
+      visited[queue[0]] = mark;
+      depth[queue[0]] = 0;
+      for (head = 0, tail = 1; head < tail; head++) {
+	y = queue[head];
+	if (bound > 0 && depth[y] >= bound)
+	  continue;
+	for (j = 0; j < g->degrees[y]; j++) {
+	  x = g->links[y][j];
+	  if (visited[x] != mark && coin_urand(set_seed, coin_link(x, y)) < p) {
+	    visited[x] = mark; // arc x -> y is live
+	    depth[x] = depth[y]+1;
+	    queue[tail++] = x;
+	  }
+	}
+      }
+      if (size + tail > capacity) {
+	while (size + tail > capacity)
+	  capacity *= 2;
+	arena = (int *) realloc(arena, capacity * sizeof(int));
+	assert(arena != NULL);
+      }
+      memcpy(arena+size, queue, tail * sizeof(int));
+      size += tail;
+      rr->offsets[i+1] = size; // end of set i in the arena of this thread
+    }
+    thread_size[tid+1] = size;
+
+    #pragma omp barrier
+    #pragma omp single
+    {
+      for (t = 0; t < nthreads; t++)
+	thread_size[t+1] += thread_size[t];
+      rr->nodes = (int *) malloc((thread_size[nthreads]+1) * sizeof(int));
+      assert(rr->nodes != NULL);
+    }
+    memcpy(rr->nodes + thread_size[tid], arena, size * sizeof(int));
+
+    // same static partition as above: rebase the ends of this thread's sets
+    #pragma omp for schedule(static)
+    for (i = 0; i < num_sets; i++)
+      rr->offsets[i+1] += thread_size[tid];
+
+    free(arena);
+    free(visited);
+    free(queue);
+    free(depth);
+  }
+  free(thread_size);
+  return rr;
+}
+
+/**
+   Greedy maximum coverage: picks k distinct seeds (k <= n) into 'seeds'
+   and stores into covered[i] the number of RR sets hit by the first i+1
+   seeds; once all the sets are hit, the next seeds are the smallest nodes
+   not picked yet
+*/
+void rrsets_greedy(RRSets *rr, int k, int *seeds, long *covered) {
+  int i, v, best;
+  long s, j, l, total = 0, size = rr->offsets[rr->num_sets];
+  long *index = (long *) calloc(rr->n+1, sizeof(long)); // node -> its sets
+  long *sets  = (long *) malloc((size+1) * sizeof(long));
+  long *gain  = (long *) malloc(rr->n * sizeof(long));
+  char *done  = (char *) calloc(rr->num_sets, sizeof(char));
+  assert(index && sets && gain && done);
+
+  // inverted index, by counting sort of the arena
+  for (j = 0; j < size; j++)
+    index[rr->nodes[j]+1]++;
+  for (v = 0; v < rr->n; v++) {
+    gain[v] = index[v+1];
+    index[v+1] += index[v];
+  }
+  for (s = 0; s < rr->num_sets; s++)
+    for (j = rr->offsets[s]; j < rr->offsets[s+1]; j++)
+      sets[index[rr->nodes[j]]++] = s;
+  for (v = rr->n; v > 0; v--) // index[v] moved to the end of v's sets
+    index[v] = index[v-1];
+  index[0] = 0;
+
+  for (i = 0; i < k; i++) {
+    best = -1;
+    for (v = 0; v < rr->n; v++)
+      if (gain[v] >= 0 && (best < 0 || gain[v] > gain[best]))
+	best = v;
+    assert(best >= 0);
+    seeds[i] = best;
+    for (j = index[best]; j < index[best+1]; j++) {
+      s = sets[j];
+      if (done[s])
+	continue;
+      done[s] = 1;
+      total++;
+      for (l = rr->offsets[s]; l < rr->offsets[s+1]; l++)
+	gain[rr->nodes[l]]--;
+    }
+    gain[best] = -1; // picked: out of the next ones
+    covered[i] = total;
+  }
+  free(index);
+  free(sets);
+  free(gain);
+  free(done);
+}
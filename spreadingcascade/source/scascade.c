@@ -16,9 +16,28 @@
 #include <string.h>
 #include <dirent.h>
 #include <omp.h>
+#include <sched.h>
 
 #include "prelim.c"
 #include "queue.c"
+#include "nodemap.c"
+#include "scheduler.c"
+#include "coins.c"
+#include "percolation.c"
+#include "sweep.c"
+#include "whatif.c"
+#include "rrsets.c"
+#include "../../source/listfile.c"     // input lists shared with simplesir
+#include "../../source/icstream.c"     // streamed initial conditions
+#include "../../source/requests.c"  // trace formats shared with simplesir
+#include "../../source/tracestats.c"
+#include "../../source/results.c"
+#include "../../source/tracezip.c"
+#include "../../source/traceindex.c"
+#include "../../source/tracefile.c"
+#include "../../source/partition.c"   // parts of a graph, for distributed runs
+#include "shards.c"                    // worker processes
+#include "transport.c"                 // messages between the processes of a distributed run
 
 // misc defs and utils
 #define VERBOSE 1
@@ -65,12 +84,14 @@ typedef struct _Epidemic {
   Stopc stop_criterion;   // ... e.g., max time or max num infected
   double p;               // neighbor infection probability
   graph *g;               // underlying graph (network)
-  FILE *output;           // trace output
-  int *infected;          // set of all infected nodes
+  TraceWriter *output;    // trace output
+  TraceStats *stats;      // aggregate statistics
+  NodeMap *infected;      // infection time of the infected nodes
   Queue *active;          // list of active infected nodes
 } Epidemic;
 
-Epidemic *epidemic_new(double p, graph *g, InitialCondition *ic, FILE *output) {
+Epidemic *epidemic_new(double p, graph *g, InitialCondition *ic, TraceWriter *output,
+		       TraceStats *stats) {
   int i;
   Epidemic *epidemic = (Epidemic *) malloc(sizeof(Epidemic));
   assert(epidemic != NULL);
@@ -84,12 +105,14 @@ Epidemic *epidemic_new(double p, graph *g, InitialCondition *ic, FILE *output) {
   epidemic->p              = p;
   epidemic->g              = g;
   epidemic->output         = output;
-  epidemic->active         = queue_new(g->n);
-  epidemic->infected       = (int *) calloc(g->n, sizeof(int));
-  assert(epidemic->infected != NULL);
+  epidemic->stats          = stats;
+  if (output && !tracewriter_begin(output, ic->id, 0))
+    epidemic->output = NULL; // not sampled: no events at all
+  epidemic->active         = queue_new(ic->num_infected + NODEMAP_MIN); // both grow
+  epidemic->infected       = nodemap_new(g->n);
   for (i = 0; i < ic->num_infected; i++) {
     queue_add(epidemic->active, ic->infected[i]);
-    epidemic->infected[ic->infected[i]] = 1; // the initial time;
+    nodemap_set(epidemic->infected, ic->infected[i], 1); // the initial time;
   }
   return epidemic;
 }
@@ -97,63 +120,101 @@ Epidemic *epidemic_new(double p, graph *g, InitialCondition *ic, FILE *output) {
 void epidemic_destroy(Epidemic *epidemic) {
   assert(epidemic != NULL);
   epidemic->g = NULL; // don't destroy the graph, since it's shared a structure generally
-  free(epidemic->infected);
+  nodemap_destroy(epidemic->infected);
   queue_destroy(epidemic->active);
   free(epidemic);
   epidemic = NULL;
 }
 
 /**
-   Run epidemic spreading until the bound condition (on time or size) is met
+   Runs the next provider of the epidemic; returns 0 once the bound
+   condition (on time or size) is met or no node is active, and the
+   epidemic must not be stepped any further
  */
-void epidemic_run(Epidemic *epidemic) {
-  int i, u, v, t;
-  
-  while (!queue_empty(epidemic->active)) {
-    u = queue_get(epidemic->active); // provider
-    t = epidemic->infected[u];       // current time
-    if (epidemic->stop_criterion == MaxTime && epidemic->bound < t)
-      return;
-    for (i = 0; i < epidemic->g->degrees[u]; i++) {
-      v = epidemic->g->links[u][i];  // client
-      if ( (double)rand() <= (double)RAND_MAX * epidemic->p ) {
-	if ( !epidemic->infected[v] ) {
-	  epidemic->infected[v] = t+1;
-	  queue_add(epidemic->active, v);
-	  epidemic->num_infected++;
-	  epidemic->cascade_links++;
-	  epidemic->t = t;
-	  if (epidemic->stop_criterion == NumInfected && epidemic->bound == epidemic->num_infected) {
-	    if (epidemic->output) // print output: t P C F
-	      fprintf(epidemic->output, "%d %d %d %d\n", t, u, v, epidemic->id);
-	    return;
-	  }
-	} else if (epidemic->infected[v] == t+1)
-	  epidemic->cascade_links++;
-	if (epidemic->output) // print output: t P C F
-	  fprintf(epidemic->output, "%d %d %d %d\n", t, u, v, epidemic->id);
-      }
+int epidemic_step(Epidemic *epidemic) {
+  int i, u, v, t, tv;
+
+  if (queue_empty(epidemic->active))
+    return 0;
+  u = queue_get(epidemic->active); // provider
+  t = nodemap_get(epidemic->infected, u); // current time
+  if (epidemic->stop_criterion == MaxTime && epidemic->bound < t)
+    return 0;
+  for (i = 0; i < epidemic->g->degrees[u]; i++) {
+    v = epidemic->g->links[u][i];  // client
+    if ( (double)rand() <= (double)RAND_MAX * epidemic->p ) {
+      tv = nodemap_get(epidemic->infected, v);
+      if ( !tv ) {
+	nodemap_set(epidemic->infected, v, t+1);
+	queue_add(epidemic->active, v);
+	epidemic->num_infected++;
+	epidemic->cascade_links++;
+	epidemic->t = t;
+	if (epidemic->stats) // the initial nodes are at t = 1
+	  tracestats_infection(epidemic->stats, t, t+1);
+	if (epidemic->stop_criterion == NumInfected && epidemic->bound == epidemic->num_infected) {
+	  if (epidemic->output) // print output: t P C F
+	    tracewriter_event(epidemic->output, t, u, v);
+	  if (epidemic->stats)
+	    tracestats_event(epidemic->stats, t);
+	  return 0;
+	}
+      } else if (tv == t+1)
+	epidemic->cascade_links++;
+      if (epidemic->output) // print output: t P C F
+	tracewriter_event(epidemic->output, t, u, v);
+      if (epidemic->stats)
+	tracestats_event(epidemic->stats, t);
     }
   }
+  return 1;
+}
+
+/**
+   Prefetches what the next steps read: the links and the infection time
+   of the next provider, and where the links of the one after are
+ */
+inline void epidemic_prefetch(Epidemic *epidemic) {
+  int u, n = queue_length(epidemic->active);
+  if (n > 0) {
+    u = queue_peek(epidemic->active, 0);
+    __builtin_prefetch(epidemic->g->links[u]);
+    nodemap_prefetch(epidemic->infected, u);
+  }
+  if (n > 1) {
+    u = queue_peek(epidemic->active, 1);
+    __builtin_prefetch(epidemic->g->links + u);
+    __builtin_prefetch(epidemic->g->degrees + u);
+  }
 }
 
 /**
-   Allocates a set of n infected nodes' id
+   Allocates the infected nodes of the 'epidemics' epidemics, of known
+   num_infected, in one arena: a flat CSR whose rows are the epidemics in
+   order, released at once by ic_free
 */
-inline void ic_init(InitialCondition *ic, int n) {
-  ic->num_infected = n;
-  ic->infected = (int *) calloc(n, sizeof(int));
-  assert(ic->infected != NULL);
+void ic_arena(InitialCondition *ic, int epidemics) {
+  int i;
+  long total = 0;
+  int *arena;
+  for (i = 0; i < epidemics; i++)
+    total += ic[i].num_infected;
+  assert(total > 0);
+  arena = (int *) calloc(total, sizeof(int));
+  assert(arena != NULL);
+  for (i = 0; i < epidemics; i++) {
+    ic[i].infected = arena;
+    arena += ic[i].num_infected;
+  }
 }
 
 /**
-   De-allocates a set of n infected nodes' id
+   Releases an array of initial conditions and its arena
 */
-inline void ic_clean(InitialCondition *ic) {
-  if(ic) {
+void ic_free(InitialCondition *ic) {
+  if (ic) {
     free(ic->infected);
-    ic->infected = NULL;
-    ic->num_infected = 0;
+    free(ic);
   }
 }
 
@@ -163,7 +224,8 @@ inline void ic_clean(InitialCondition *ic) {
 inline InitialCondition *ic_trivial() {
   InitialCondition *ic = (InitialCondition *) calloc(1,sizeof(InitialCondition));
   assert(ic != NULL);
-  ic_init(ic, 1);
+  ic->num_infected = 1;
+  ic_arena(ic, 1);
   ic->infected[0] = 0;
   return ic;
 }
@@ -172,12 +234,14 @@ inline InitialCondition *ic_trivial() {
    Returns 'epidemics' epidemics with one randomly infected node
 */
 InitialCondition *ic_random_epidemics(int epidemics, int total_nodes) {
-  int i, j, id;
+  int i;
   InitialCondition *ic = (InitialCondition *) calloc(epidemics, sizeof(InitialCondition));
   assert(ic != NULL);
 
+  for (i = 0; i < epidemics; i++)
+    (ic+i)->num_infected = 1;
+  ic_arena(ic, epidemics);
   for (i = 0; i < epidemics; i++) {
-    ic_init(ic+i, 1);
     (ic+i)->id = i;
     (ic+i)->infected[0] = rand() % total_nodes;
   }
@@ -220,85 +284,1224 @@ void ic_infect_randomly(InitialCondition *ic, int total_nodes) {
    <number of epidemics>
    <epidemic id> <N, number of infected nodes> [<node 1> ... <node N>]
    ...
+   or its binary form (see listfile.h)
 */
 int ic_import(InitialCondition **ic, FILE *input, int total_nodes) {
-  int i, j, id, num_infected, tokens_read, epidemics = 0;
-  assert(input != NULL);
-  tokens_read = fscanf(input, "%d\n", &epidemics);
-  assert(tokens_read == 1);
-  assert(epidemics > 0);
+  int i, j, id, num_infected, t, tokens_read, epidemics = 0;
+  long n = 0, capacity = 0, start;
+  int *nodes = NULL;
+  const int *row;
+  ListFile *lf = listfile_open(input);
   assert(ic != NULL);
+  if (lf->type) {
+    assert(lf->type == LIST_EPIDEMICS);
+    epidemics = (int) lf->rows;
+  } else {
+    tokens_read = listfile_int(lf, &epidemics);
+    assert(tokens_read == 1);
+  }
+  assert(epidemics > 0);
   *ic = (InitialCondition *) calloc(epidemics, sizeof(InitialCondition));
   assert(*ic != NULL);
 
-  for (i = 0; i < epidemics; i++) {
-    tokens_read = fscanf(input, "%d %d", &id, &num_infected);
-    assert(tokens_read == 2 && num_infected > 0);
-    ic_init(*ic+i, num_infected);
-    (*ic+i)->id = id;
-    if(total_nodes)
-      ic_infect_randomly(*ic+i, total_nodes);
-    else
-      for (j = 0; j < num_infected; j++) {
-	tokens_read = fscanf(input, "%d", &(*ic+i)->infected[j]);
-	assert(tokens_read == 1);
+  if (lf->type) { // sizes first, then the nodes (the times are not used here)
+    start = lf->pos;
+    for (i = 0; i < epidemics; i++) {
+      row = (const int *) listfile_array(lf, 2*sizeof(int));
+      assert(row != NULL && row[1] > 0);
+      (*ic+i)->id = row[0];
+      (*ic+i)->num_infected = row[1];
+      row = (const int *) listfile_array(lf, 2L*row[1]*sizeof(int));
+      assert(row != NULL);
+    }
+    ic_arena(*ic, epidemics);
+    lf->pos = start;
+    for (i = 0; i < epidemics; i++) {
+      row = (const int *) listfile_array(lf, (2L + 2L*(*ic+i)->num_infected)*sizeof(int)) + 2;
+      for (j = 0; j < (*ic+i)->num_infected; j++)
+	(*ic+i)->infected[j] = row[2*j];
+    }
+  } else { // text: the nodes are gathered, then copied into the arena
+    for (i = 0; i < epidemics; i++) {
+      tokens_read = listfile_int(lf, &id) + listfile_int(lf, &num_infected);
+      assert(tokens_read == 2);
+      assert(num_infected > 0);
+      (*ic+i)->id = id;
+      (*ic+i)->num_infected = num_infected;
+      if (total_nodes)
+	continue;
+      if (n + num_infected > capacity) {
+	while (n + num_infected > capacity)
+	  capacity = capacity? 2*capacity : 1024;
+	nodes = (int *) realloc(nodes, capacity*sizeof(int));
+	assert(nodes != NULL);
       }
+      for (j = 0; j < num_infected; j++, n++) {
+	tokens_read = listfile_node(lf, nodes+n, &t);
+	assert(tokens_read >= 1);
+      }
+    }
+    ic_arena(*ic, epidemics);
+    if (n > 0)
+      memcpy((*ic)->infected, nodes, n*sizeof(int));
+    free(nodes);
   }
+  if (total_nodes)
+    for (i = 0; i < epidemics; i++)
+      ic_infect_randomly(*ic+i, total_nodes);
+  listfile_close(lf, "initial conditions");
   return epidemics;
 }
 
 /**
    Import stop bounds for each epidemic in the array *ic from file
-   composed of a collection of lines with: <id> <bound>
+   composed of a collection of lines with: <id> <bound> (or its binary
+   form)
 */
 void ic_import_bounds(InitialCondition *ic, int n, Stopc stop_criterion, FILE *input) {
   int i, id, bound, tokens_read;
+  const int *rows = NULL;
+  ListFile *lf;
   assert(n > 0);
   assert(ic != NULL);
   assert(input != NULL);
-  
+  lf = listfile_open(input);
+  if (lf->type) {
+    assert(lf->type == LIST_BOUNDS && lf->rows >= n);
+    rows = (const int *) listfile_array(lf, 2L*n*sizeof(int));
+    assert(rows != NULL);
+  }
+
   for (i = 0; i < n; i++) {
-    tokens_read = fscanf(input, "%d %d\n", &id, &bound);
-    assert(tokens_read == 2);
+    if (rows) {
+      id    = rows[2*i];
+      bound = rows[2*i+1];
+    } else {
+      tokens_read = listfile_int(lf, &id) + listfile_int(lf, &bound);
+      assert(tokens_read == 2);
+    }
     assert(id == ic[i].id);
     ic[i].bound = bound;
     ic[i].stop_criterion = stop_criterion;
   }
+  listfile_close(lf, "bounds");
 }
 
+/**
+   Import list of nodes from file:
+   <number of nodes N>
+   <node 1>
+   ...
+   <node N>
+*/
+int import_nodes(int **nodes, FILE *input, int total_nodes) {
+  int i, n, tokens_read;
+  assert(input != NULL);
+  tokens_read = fscanf(input, "%d\n", &n);
+  assert(tokens_read == 1 && n > 0);
+  *nodes = (int *) malloc(n * sizeof(int));
+  assert(*nodes != NULL);
+  for (i = 0; i < n; i++) {
+    tokens_read = fscanf(input, "%d", *nodes+i);
+    assert(tokens_read == 1);
+    assert((*nodes)[i] >= 0 && (*nodes)[i] < total_nodes);
+  }
+  return n;
+}
+
+/**
+   What-if evaluation of candidate seeds: each candidate is added to the
+   seeds of each epidemic and removed again, under the same sample of live
+   arcs; writes the lines <id> <sample> <candidate> <infected nodes> to
+   'output'
+*/
+void whatif_epidemics(double p, graph *g, InitialCondition *ic, int epidemics, int samples,
+		      int *candidates, int num_candidates, FILE *data_output, FILE *output) {
+  int i, j, k, base, gain, tid = 0;
+  WhatIf *w;
+
+  #if PARALLEL
+  #pragma omp parallel private(w,tid,i,j,k,base,gain)
+  #endif
+  {
+    w = whatif_new(g, p);
+  #if PARALLEL
+    tid = omp_get_thread_num();
+    #pragma omp for schedule(guided)
+  #endif
+    for (j = 0; j < epidemics; j++) {
+      assert(ic[j].stop_criterion == MaxTime);
+      fprintf(stderr,"%s- thread %d: what-if of %d candidates for epidemic %d with p = %f upto %s = %d ...\n",
+	      tstamp(), tid, num_candidates, ic[j].id, p, stopc_description[MaxTime], ic[j].bound);
+      fflush(stderr);
+
+      for (i = 1; i <= samples; i++) {
+	whatif_reset(w, ic[j].bound, coin_seed());
+	for (k = 0; k < ic[j].num_infected; k++)
+	  whatif_add(w, ic[j].infected[k]);
+	base = w->num_infected;
+	if (data_output)
+	  fprintf(data_output,
+		  "Epidemic %d #%d: seeds reach %d / %d ( %.2f%% ) infected nodes\n",
+		  ic[j].id, i, base, g->n, 100.0*(float)base/(float)g->n);
+	for (k = 0; k < num_candidates; k++) {
+	  gain = whatif_add(w, candidates[k]);
+	  if (output)
+	    fprintf(output, "%d %d %d %d\n", ic[j].id, i, candidates[k], base+gain);
+	  if (data_output)
+	    fprintf(data_output,
+		    "Epidemic %d #%d: candidate %d adds %d infected nodes\n",
+		    ic[j].id, i, candidates[k], gain);
+	  whatif_remove(w, candidates[k]);
+	}
+      }
+    }
+    whatif_destroy(w);
+  }
+  if (output)
+    fflush(output);
+  if (data_output)
+    fflush(data_output);
+}
+
+/**
+   Final sizes of all epidemics from 'samples' percolated graphs; writes
+   one line <id> <sample> <size> per epidemic and sample to 'output'
+*/
+void percolation_epidemics(double p, graph *g, InitialCondition *ic, int epidemics,
+			   int samples, FILE *data_output, FILE *output) {
+  int i, j, size;
+  Percolation *perc = percolation_new(g);
+
+  for (i = 1; i <= samples; i++) {
+    fprintf(stderr,"%s- percolation sample #%d with p = %f ...\n", tstamp(), i, p);
+    fflush(stderr);
+    percolation_sample(perc, g, p, coin_seed());
+
+    #if PARALLEL
+    #pragma omp parallel for private(size) schedule(static)
+    #endif
+    for (j = 0; j < epidemics; j++) {
+      size = percolation_final_size(perc, ic[j].infected, ic[j].num_infected);
+      if (output)
+	fprintf(output, "%d %d %d\n", ic[j].id, i, size);
+      if (data_output)
+	fprintf(data_output,
+		"Epidemic %d #%d: percolated from %d to %d / %d ( %.2f%% ) infected nodes\n",
+		ic[j].id, i, ic[j].num_infected, size, g->n, 100.0*(float)size/(float)g->n);
+    }
+    if (output)
+      fflush(output);
+    if (data_output)
+      fflush(data_output);
+  }
+  percolation_destroy(perc);
+}
+
+/**
+   Epidemics run once per sample for the whole grid 'pgrid' of spreading
+   probabilities, with common random numbers; writes the incidence lines
+   <id> <sample> <p> <t> <new infected nodes> to 'output'
+*/
+void sweep_epidemics(double *pgrid, int num_p, graph *g, InitialCondition *ic, int epidemics,
+		     int samples, FILE *data_output, FILE *output) {
+  int i, j, k, t, size, end, tid = 0;
+  Sweep *sw;
+
+  #if PARALLEL
+  #pragma omp parallel private(sw,tid,i,j,k,t,size,end)
+  #endif
+  {
+    sw = sweep_new(g, pgrid, num_p);
+  #if PARALLEL
+    tid = omp_get_thread_num();
+    #pragma omp for schedule(guided)
+  #endif
+    for (j = 0; j < epidemics; j++) {
+      assert(ic[j].stop_criterion == MaxTime);
+      fprintf(stderr,"%s- thread %d: sweeping epidemic %d over %d values of p upto %s = %d ...\n",
+	      tstamp(), tid, ic[j].id, num_p, stopc_description[MaxTime], ic[j].bound);
+      fflush(stderr);
+
+      for (i = 1; i <= samples; i++) {
+	sweep_run(sw, g, ic[j].infected, ic[j].num_infected, ic[j].bound, coin_seed());
+	for (k = 0; k < num_p; k++) {
+	  size = 0;
+	  end  = 1;
+	  for (t = 1; t <= ic[j].bound+1; t++)
+	    if (sweep_incidence(sw, t, k) > 0) {
+	      size += sweep_incidence(sw, t, k);
+	      if (t > 1)
+		end = t-1;
+	      if (output)
+		fprintf(output, "%d %d %f %d %d\n", ic[j].id, i, pgrid[k], t,
+			sweep_incidence(sw, t, k));
+	    }
+	  if (data_output)
+	    fprintf(data_output,
+		    "Epidemic %d #%d: p = %f stopped at t = %d with %d / %d ( %.2f%% ) infected nodes\n",
+		    ic[j].id, i, pgrid[k], end, size, g->n, 100.0*(float)size/(float)g->n);
+	}
+      }
+    }
+    sweep_destroy(sw);
+  }
+  if (output)
+    fflush(output);
+  if (data_output)
+    fflush(data_output);
+}
+
+/**
+   Seed selection by reverse-reachable sets: samples 'num_sets' RR sets
+   (reverse BFS up to depth 'bound', none if bound <= 0) and picks 'k'
+   seeds by greedy maximum coverage; the seeds and their cumulative spread
+   estimates are written to 'data_output', and the seed set to 'output' in
+   the initial conditions format
+*/
+void rrsets_seeds(double p, graph *g, int bound, long num_sets, int k,
+		  FILE *data_output, FILE *output) {
+  int i, *seeds;
+  long *covered;
+  RRSets *rr;
+
+  assert(k > 0 && k <= g->n && num_sets > 0);
+  fprintf(stderr,"%s- sampling %ld RR sets with p = %f upto %s = %d ...\n",
+	  tstamp(), num_sets, p, stopc_description[MaxTime], bound);
+  fflush(stderr);
+  rr = rrsets_sample(g, p, bound, num_sets, coin_seed());
+  fprintf(stderr,"%s- %ld RR sets with %ld nodes ( %.2f per set ); selecting %d seeds ...\n",
+	  tstamp(), rr->num_sets, rr->offsets[rr->num_sets],
+	  (double)rr->offsets[rr->num_sets]/(double)rr->num_sets, k);
+  fflush(stderr);
+
+  seeds   = (int *) malloc(k * sizeof(int));
+  covered = (long *) malloc(k * sizeof(long));
+  assert(seeds != NULL && covered != NULL);
+  rrsets_greedy(rr, k, seeds, covered);
+
+  for (i = 0; i < k; i++)
+    fprintf(data_output? data_output : stdout,
+	    "Seed %d: node %d, %d seeds reach %.2f / %d ( %.2f%% ) infected nodes\n",
+	    i+1, seeds[i], i+1, (double)g->n*covered[i]/(double)num_sets, g->n,
+	    100.0*(double)covered[i]/(double)num_sets);
+  if (output) {
+    fprintf(output, "1\n0 %d", k);
+    for (i = 0; i < k; i++)
+      fprintf(output, " %d", seeds[i]);
+    fputc('\n', output);
+  }
+  fflush(data_output? data_output : stdout);
+  free(seeds);
+  free(covered);
+  rrsets_destroy(rr);
+}
+
+// Epidemics of the run, scheduled over the threads
+#define SHARE_FRONTIER 4096 // active nodes from which an epidemic is shared with idle threads
+#define SHARE_CHUNK    256  // nodes of a level of a shared epidemic per chunk
+
+typedef struct _SharedEpidemic {
+  Epidemic *epidemic;     // of the owner, its infected map made dense
+  int *frontier, *next;   // active nodes of the current level, of the next one
+  int size, next_size;
+  int t;                  // time of the current level
+  int chunks, next_chunk; // chunks of the current level, claimed under the lock
+  int pending;            // chunks of the current level not done yet
+  int helpers;            // idle threads running chunks
+  omp_lock_t lock;
+} SharedEpidemic;
+
+typedef struct _EpidemicTasks {
+  Scheduler *sched;       // task ids, by estimated cost
+  InitialCondition *ic;   // loaded epidemics (task id: index) ...
+  ICStream *stream;       // ... or streamed (task id: batch * batch size + record)
+  InitialCondition *streamed; // records of the batches of the stream
+  int *pending;           // epidemics of each batch not done
+  int maxtime;            // global bound of the streamed epidemics
+  Stopc stop_criterion;
+  graph *g;
+  double growth;          // infections per infected node, for the cost estimates
+  SharedEpidemic *shared; // epidemic shared with the idle threads, or NULL
+  omp_lock_t lock;        // of 'shared'
+  int verbose;            // status line of each epidemic on stderr (off when embedded)
+} EpidemicTasks;
+
+typedef struct _EpidemicSlot {
+  Epidemic *epidemic;     // running epidemic, NULL when the slot is free
+  InitialCondition *ic;   // its initial condition ...
+  int sample;             // ... and sample
+  int task;               // task id of the initial condition
+  double wall_time;       // wall clock at its start
+  TraceWriter *writer;    // trace of the epidemics of the slot
+} EpidemicSlot;
+
+/**
+   Infections per infected node of a branching process on 'g': p times
+   the mean excess degree
+*/
+double graph_growth(graph *g, double p) {
+  int i;
+  double k = 0.0, k2 = 0.0;
+  for (i = 0; i < g->n; i++) {
+    k  += g->degrees[i];
+    k2 += (double)g->degrees[i] * g->degrees[i];
+  }
+  return (k > 0.0)? p * (k2 - k) / k : 0.0;
+}
+
+/**
+   Estimated cost (arcs scanned) of epidemic 'ic': the degrees of its
+   seeds, times the growth of a branching process up to a depth bound, or
+   plus the mean degree times a size bound; at most all the arcs
+*/
+double ic_cost(InitialCondition *ic, graph *g, double growth) {
+  int i;
+  double cost = 0.0, level, arcs = 2.0*g->m;
+  for (i = 0; i < ic->num_infected; i++)
+    cost += g->degrees[ic->infected[i]];
+  if (ic->stop_criterion == NumInfected)
+    cost += (double)ic->bound * arcs / (double)g->n;
+  else
+    for (i = 1, level = cost; i < ic->bound && cost < arcs; i++) {
+      level *= growth;
+      cost  += level;
+    }
+  return (cost < arcs)? cost : arcs;
+}
+
+/**
+   Tasks of the loaded epidemics 'ic' (dealt to the threads) or of the
+   stream 'stream' (pushed by batches, see epidemic_task); 'growth' is
+   graph_growth(g, p), computed once for all the runs on 'g'
+*/
+void tasks_init(EpidemicTasks *tasks, int threads, double growth, graph *g, InitialCondition *ic,
+		int epidemics, ICStream *stream, int maxtime, Stopc stop_criterion) {
+  int i;
+  Task *loaded;
+
+  tasks->sched          = scheduler_new(threads);
+  tasks->ic             = ic;
+  tasks->stream         = stream;
+  tasks->streamed       = NULL;
+  tasks->pending        = NULL;
+  tasks->maxtime        = maxtime;
+  tasks->stop_criterion = stop_criterion;
+  tasks->g              = g;
+  tasks->growth         = growth;
+  tasks->shared         = NULL;
+  tasks->verbose        = VERBOSE;
+  omp_init_lock(&tasks->lock);
+  if (stream) {
+    tasks->streamed = (InitialCondition *) malloc((long)stream->num_batches * stream->batch_size *
+						  sizeof(InitialCondition));
+    tasks->pending  = (int *) calloc(stream->num_batches, sizeof(int));
+    assert(tasks->streamed != NULL && tasks->pending != NULL);
+  } else {
+    loaded = (Task *) malloc(epidemics * sizeof(Task));
+    assert(loaded != NULL);
+    for (i = 0; i < epidemics; i++) {
+      loaded[i].id   = i;
+      loaded[i].cost = ic_cost(ic+i, g, tasks->growth);
+    }
+    scheduler_deal(tasks->sched, loaded, epidemics);
+    free(loaded);
+  }
+}
+
+void tasks_clean(EpidemicTasks *tasks) {
+  scheduler_destroy(tasks->sched);
+  omp_destroy_lock(&tasks->lock);
+  free(tasks->streamed);
+  free(tasks->pending);
+}
+
+/**
+   Next epidemic of thread 'tid': the largest of its deque, else one of
+   the next batch of the stream (whose records are pushed to its deque),
+   else the smallest of another thread; NULL if none is left
+*/
+InitialCondition *epidemic_task(EpidemicTasks *tasks, int tid, int *id) {
+  int i, b;
+  ICBatch *batch;
+  InitialCondition *ic;
+  Task task, *pushed;
+
+  for (;;) {
+    if (scheduler_pop(tasks->sched, tid, &task) || // own tasks first
+	(!tasks->stream && scheduler_steal(tasks->sched, tid, &task)))
+      break;
+    if (!tasks->stream)
+      return NULL;
+    if ((batch = icstream_next(tasks->stream)) == NULL) { // the stream is over
+      if (scheduler_steal(tasks->sched, tid, &task))
+	break;
+      return NULL;
+    }
+    b = batch - tasks->stream->pool;
+    pushed = (Task *) malloc(batch->count * sizeof(Task));
+    assert(pushed != NULL);
+    for (i = 0; i < batch->count; i++) {
+      ic = tasks->streamed + (long)b * tasks->stream->batch_size + i;
+      ic->id             = batch->records[i].id;
+      ic->num_infected   = batch->records[i].num_infected;
+      ic->infected       = batch->records[i].infected;
+      ic->bound          = tasks->maxtime? tasks->maxtime : batch->records[i].bound;
+      ic->stop_criterion = tasks->stop_criterion;
+      pushed[i].id       = b * tasks->stream->batch_size + i;
+      pushed[i].cost     = ic_cost(ic, tasks->g, tasks->growth);
+    }
+    tasks->pending[b] = batch->count;
+    scheduler_push(tasks->sched, tid, pushed, batch->count);
+    free(pushed);
+  }
+  *id = task.id;
+  return tasks->stream? tasks->streamed + task.id : tasks->ic + task.id;
+}
+
+/**
+   All the samples of task 'id' are done: its batch goes back to the
+   stream with its last epidemic
+*/
+void epidemic_task_done(EpidemicTasks *tasks, int id) {
+  int b;
+  if (!tasks->stream)
+    return;
+  b = id / tasks->stream->batch_size;
+  if (__sync_sub_and_fetch(tasks->pending + b, 1) == 0)
+    icstream_release(tasks->stream, tasks->stream->pool + b);
+}
+
+/**
+   Claims the next chunk of the current level of 'sh'; -1 if none is left
+*/
+int shared_claim(SharedEpidemic *sh) {
+  int c = -1;
+  omp_set_lock(&sh->lock);
+  if (sh->next_chunk < sh->chunks)
+    c = sh->next_chunk++;
+  omp_unset_lock(&sh->lock);
+  return c;
+}
+
+/**
+   Runs chunk 'c' of the current level of the shared epidemic 'sh': the
+   infection times are set by compare and swap, so that each node is
+   infected once, and the new infected nodes appended to the next level
+*/
+void shared_chunk(SharedEpidemic *sh, int c, TraceWriter *output, TraceStats *stats) {
+  int i, j, u, v, t = sh->t, infected = 0, links = 0;
+  Epidemic *epidemic = sh->epidemic;
+  int *times = epidemic->infected->values;
+  graph *g = epidemic->g;
+
+  for (j = c*SHARE_CHUNK; j < sh->size && j < (c+1)*SHARE_CHUNK; j++) {
+    u = sh->frontier[j]; // provider
+    for (i = 0; i < g->degrees[u]; i++) {
+      v = g->links[u][i];  // client
+      if ( (double)rand() <= (double)RAND_MAX * epidemic->p ) {
+	if (__sync_bool_compare_and_swap(times + v, 0, t+1)) {
+	  sh->next[__sync_fetch_and_add(&sh->next_size, 1)] = v;
+	  infected++;
+	  links++;
+	  if (stats)
+	    tracestats_infection(stats, t, t+1);
+	} else if (times[v] == t+1)
+	  links++;
+	if (output) // print output: t P C F
+	  tracewriter_event(output, t, u, v);
+	if (stats)
+	  tracestats_event(stats, t);
+      }
+    }
+  }
+  if (infected) {
+    __sync_fetch_and_add(&epidemic->num_infected, infected);
+    epidemic->t = t;
+  }
+  __sync_fetch_and_add(&epidemic->cascade_links, links);
+  __sync_fetch_and_sub(&sh->pending, 1);
+}
+
+/**
+   Runs the rest of 'epidemic' (bounded in time) level by level, with
+   the help of the idle threads; returns 0, leaving it as is, if another
+   epidemic is already shared
+*/
+int epidemic_share(EpidemicTasks *tasks, Epidemic *epidemic) {
+  int k, *swap;
+  SharedEpidemic sh;
+
+  omp_set_lock(&tasks->lock);
+  if (tasks->shared) {
+    omp_unset_lock(&tasks->lock);
+    return 0;
+  }
+  nodemap_dense(epidemic->infected);
+  sh.epidemic   = epidemic;
+  sh.frontier   = (int *) malloc(epidemic->g->n * sizeof(int));
+  sh.next       = (int *) malloc(epidemic->g->n * sizeof(int));
+  assert(sh.frontier != NULL && sh.next != NULL);
+  for (sh.size = 0; !queue_empty(epidemic->active); sh.size++)
+    sh.frontier[sh.size] = queue_get(epidemic->active);
+  sh.next_size  = 0;
+  sh.chunks     = sh.next_chunk = sh.pending = 0;
+  sh.helpers    = 0;
+  omp_init_lock(&sh.lock);
+  tasks->shared = &sh;
+  omp_unset_lock(&tasks->lock);
+
+  while (sh.size > 0) {
+    // the queue held at most two levels: the next one starts the next level
+    sh.t = epidemic->infected->values[sh.frontier[0]];
+    for (k = 0; k < sh.size && epidemic->infected->values[sh.frontier[k]] == sh.t; k++)
+      ;
+    if (epidemic->bound < sh.t)
+      break;
+    memcpy(sh.next, sh.frontier + k, (sh.size - k) * sizeof(int));
+    sh.next_size = sh.size - k;
+    sh.size = k;
+
+    omp_set_lock(&sh.lock); // publish the level
+    sh.chunks     = (sh.size + SHARE_CHUNK-1) / SHARE_CHUNK;
+    sh.pending    = sh.chunks;
+    sh.next_chunk = 0;
+    omp_unset_lock(&sh.lock);
+    while ((k = shared_claim(&sh)) >= 0)
+      shared_chunk(&sh, k, epidemic->output, epidemic->stats);
+    while (__sync_fetch_and_add(&sh.pending, 0) > 0)
+      sched_yield();
+
+    swap        = sh.frontier;
+    sh.frontier = sh.next;
+    sh.next     = swap;
+    sh.size     = sh.next_size;
+    sh.next_size = 0;
+  }
+
+  omp_set_lock(&tasks->lock);
+  tasks->shared = NULL;
+  omp_unset_lock(&tasks->lock);
+  while (__sync_fetch_and_add(&sh.helpers, 0) > 0)
+    sched_yield();
+  omp_destroy_lock(&sh.lock);
+  free(sh.frontier);
+  free(sh.next);
+  return 1;
+}
+
+/**
+   Runs the chunks of the shared epidemic, if any, with the writer and
+   counts of an idle thread; returns 0 if there is none
+*/
+int epidemic_help(EpidemicTasks *tasks, TraceWriter *writer, TraceStats *stats) {
+  int c;
+  SharedEpidemic *sh;
+
+  omp_set_lock(&tasks->lock);
+  if ((sh = tasks->shared) != NULL)
+    __sync_fetch_and_add(&sh->helpers, 1);
+  omp_unset_lock(&tasks->lock);
+  if (!sh)
+    return 0;
+  if (writer && !tracewriter_begin(writer, sh->epidemic->id, 0))
+    writer = NULL;
+  while ((c = shared_claim(sh)) >= 0)
+    shared_chunk(sh, c, writer, stats);
+  __sync_fetch_and_sub(&sh->helpers, 1);
+  return 1;
+}
+
+/**
+   Thread 'tid' is out of work: helps with the shared epidemic until it
+   can steal a task (pushed to its deque) and returns 1, or returns 0
+   once all of the 'threads' threads are idle, the run being over
+*/
+int epidemic_wait(EpidemicTasks *tasks, int tid, int threads, TraceWriter *writer,
+		  TraceStats *stats) {
+  Task task;
+  int stolen = 0, over = 0;
+
+  omp_set_lock(&tasks->sched->lock);
+  tasks->sched->idle++;
+  omp_unset_lock(&tasks->sched->lock);
+  while (!stolen && !over) {
+    if (!epidemic_help(tasks, writer, stats)) {
+      omp_set_lock(&tasks->sched->lock); // steals and the count of idle threads agree
+      if ((stolen = scheduler_steal(tasks->sched, tid, &task)))
+	tasks->sched->idle--;
+      else
+	over = (tasks->sched->idle == threads);
+      omp_unset_lock(&tasks->sched->lock);
+    }
+    if (!stolen && !over)
+      sched_yield();
+  }
+  if (stolen)
+    scheduler_push(tasks->sched, tid, &task, 1);
+  return stolen;
+}
+
+/**
+   Starts sample 'sample' of the initial condition 'ic' in slot 's', with
+   a status line of the epidemic if 'verbose'
+*/
+void epidemic_slot_start(EpidemicSlot *s, InitialCondition *ic, int sample, double p, graph *g,
+			 int tid, int verbose, TraceStats *stats, FILE *data_output,
+			 char *trace_output_path) {
+  if (sample == 1 && verbose) {
+    fprintf(stderr,"%s- thread %d: running epidemic %d with p = %f upto %s = %d %s%s ...\n",
+	    tstamp(), tid, ic->id, p, stopc_description[ic->stop_criterion], ic->bound,
+	    !trace_output_path? "" : ", output: ", !trace_output_path? "" : trace_output_path);
+    fflush(stderr);
+  }
+  s->ic        = ic;
+  s->sample    = sample;
+  s->wall_time = results_clock();
+  s->epidemic  = epidemic_new(p, g, ic, s->writer, stats);
+
+  if (data_output) {
+    fprintf(data_output,
+	    "Epidemic %d #%d: started at t = %d with %d / %d ( %.2f%% ) infected nodes\n",
+	    s->epidemic->id, sample, s->epidemic->t, s->epidemic->num_infected,
+	    g->n, 100.0*(float)s->epidemic->num_infected/(float)g->n);
+    fflush(data_output);
+  }
+}
+
+/**
+   Records the epidemic of slot 's', which is over, and frees the slot
+*/
+void epidemic_slot_finish(EpidemicSlot *s, TraceStats *stats, ResultsWriter *results_writer,
+			  FILE *data_output) {
+  ResultRow row;
+  Epidemic *epidemic = s->epidemic;
+
+  row.max_depth = (epidemic->num_infected > s->ic->num_infected)? epidemic->t+1 : 1;
+  if (stats) {
+    stats->max_depth = row.max_depth; // its infections may be interleaved with others'
+    tracestats_epidemic(stats, epidemic->num_infected);
+  }
+  if (results_writer) {
+    row.id            = epidemic->id;
+    row.sample        = s->sample;
+    row.branch        = 0;
+    row.seeds         = s->ic->num_infected;
+    row.bound         = epidemic->bound;
+    row.size          = epidemic->num_infected;
+    row.cascade_links = epidemic->cascade_links;
+    row.end_time      = epidemic->t;
+    row.wall_time     = results_clock() - s->wall_time;
+    resultswriter_add(results_writer, &row);
+  }
+
+  if (data_output) {
+    fprintf(data_output,
+	    "Epidemic %d #%d: stopped at t = %d with %d / %d ( %.2f%% ) infected nodes and %d links\n",
+	    epidemic->id, s->sample, epidemic->t, epidemic->num_infected,
+	    epidemic->g->n, 100.0*(float)epidemic->num_infected/(float)epidemic->g->n,
+	    epidemic->cascade_links);
+    fflush(data_output);
+  }
+
+  epidemic_destroy(epidemic);
+  s->epidemic = NULL;
+}
+
+/**
+   Runs the 'samples' epidemics of the tasks of thread 'tid', 'interleave'
+   at a time: a step runs the next provider of one epidemic and prefetches
+   what its next step reads, then moves on to the next epidemic, so that
+   the cache misses of one overlap the work of the others. An epidemic
+   whose frontier gets large while other threads are idle is shared with
+   them. Slot k is traced by writers[k] (if 'writers'), the chunks of the
+   epidemics of other threads by writers[interleave]
+*/
+void simulate_epidemics(EpidemicTasks *tasks, double p, graph *g, int samples, int interleave,
+			int tid, int threads, TraceWriter **writers, TraceStats *stats,
+			ResultsWriter *results_writer, FILE *data_output, char *trace_output_path) {
+  int k, id, running, more;
+  EpidemicSlot *slots = (EpidemicSlot *) calloc(interleave, sizeof(EpidemicSlot));
+  EpidemicSlot *s;
+  InitialCondition *ic;
+
+  assert(slots != NULL);
+  for (k = 0; k < interleave; k++)
+    slots[k].writer = writers? writers[k] : NULL;
+  do {
+    more = 1;
+    do {
+      running = 0;
+      for (k = 0; k < interleave; k++) {
+	s = slots + k;
+	if (!s->epidemic && s->ic && s->sample < samples) // the next sample
+	  epidemic_slot_start(s, s->ic, s->sample + 1, p, g, tid, tasks->verbose, stats,
+			      data_output, trace_output_path);
+	else if (!s->epidemic && more) { // the next epidemic
+	  if ((ic = epidemic_task(tasks, tid, &id)) != NULL) {
+	    s->task = id;
+	    epidemic_slot_start(s, ic, 1, p, g, tid, tasks->verbose, stats, data_output,
+				trace_output_path);
+	  } else
+	    more = 0;
+	}
+	if (!s->epidemic)
+	  continue;
+	running = 1;
+	if (epidemic_step(s->epidemic)) {
+	  epidemic_prefetch(s->epidemic);
+	  if (tasks->sched->idle > 0 && !tasks->shared && s->epidemic->stop_criterion == MaxTime &&
+	      queue_length(s->epidemic->active) >= SHARE_FRONTIER)
+	    epidemic_share(tasks, s->epidemic);
+	} else {
+	  epidemic_slot_finish(s, stats, results_writer, data_output);
+	  if (s->sample == samples) {
+	    epidemic_task_done(tasks, s->task);
+	    s->ic = NULL;
+	  }
+	}
+      }
+    } while (running);
+  } while (epidemic_wait(tasks, tid, threads, writers? writers[interleave] : NULL, stats));
+  free(slots);
+}
+
+/**
+   Simulation of the tasks over the threads of the team, one per deque of
+   the tasks, into the trace ('stage', 'requests' or 'trace_callback'),
+   the statistics 'stats' and the table of results 'results', each optional
+*/
+void simulate_run(EpidemicTasks *tasks, double p, graph *g, int samples, int interleave,
+		  TraceOutput *stage, RequestSink *requests, TraceCallback trace_callback,
+		  void *trace_user, double sample_rate, int step_events, TraceStats *stats,
+		  ResultsTable *results, FILE *data_output, char *trace_output_path) {
+  int k, tid = 0, team = 1;
+  TraceWriter **writers;
+  TraceStats *thread_stats;
+  ResultsWriter *results_writer;
+
+  #if PARALLEL
+  #pragma omp parallel default(none) num_threads(tasks->sched->num_deques)	\
+  private(tid,team,k,writers,thread_stats,results_writer)		\
+  shared(stderr,p,g,tasks,samples,data_output,trace_output_path,	\
+	 requests,stage,trace_callback,trace_user,stats,results,	\
+	 sample_rate,step_events,interleave)
+  #endif
+  {
+    writers = NULL; // one writer per interleaved epidemic of each thread, and one to help
+    if (requests || stage || trace_callback) {
+      writers = (TraceWriter **) malloc((interleave+1) * sizeof(TraceWriter *));
+      assert(writers != NULL);
+      for (k = 0; k <= interleave; k++) {
+	writers[k] = requests? tracewriter_requests(requests) :
+	  trace_callback? tracewriter_callback(trace_callback, trace_user) : tracewriter_new(stage);
+	tracewriter_sample(writers[k], sample_rate, step_events);
+      }
+    }
+    thread_stats = stats? tracestats_new() : NULL; // merged at the end
+    results_writer = results? resultswriter_new(results) : NULL;
+  #if PARALLEL
+    tid  = omp_get_thread_num();
+    team = omp_get_num_threads();
+  #endif
+    simulate_epidemics(tasks, p, g, samples, interleave, tid, team, writers,
+		       thread_stats, results_writer, data_output, trace_output_path);
+    if (writers) {
+      for (k = 0; k <= interleave; k++)
+	tracewriter_destroy(writers[k]);
+      free(writers);
+    }
+    if (thread_stats) {
+      tracestats_merge(stats, thread_stats);
+      tracestats_destroy(thread_stats);
+    }
+    if (results_writer)
+      resultswriter_destroy(results_writer);
+  }
+}
+
+// Sharded runs (see shards.c)
+typedef struct _ShardJob {
+  InitialCondition *ic;   // all the epidemics ...
+  int *first;             // ... shard k runs ic[first[k]..first[k+1])
+  double p;
+  double growth;          // graph_growth(g, p)
+  graph *g;
+  int maxtime;
+  Stopc stop_criterion;
+  int samples, threads, interleave;
+  double sample_rate;
+  int step_events;
+  char *trace_path;       // outputs of the run, NULL if none: the
+  char *stats_path;       // shards write to PATH.shardK
+  char *results_path;
+  FILE *data_output;
+  char *trace_output_path;
+} ShardJob;
+
+/**
+   Cuts the 'epidemics' epidemics 'ic' into 'num_shards' ranges of about
+   the same estimated cost; returns the first epidemic of each range,
+   followed by 'epidemics'
+*/
+int *shard_ranges(InitialCondition *ic, int epidemics, int num_shards, graph *g, double growth) {
+  int j, k;
+  double total = 0.0, sum = 0.0;
+  double *cost = (double *) malloc(epidemics * sizeof(double));
+  int *first = (int *) malloc((num_shards+1) * sizeof(int));
+
+  assert(cost != NULL && first != NULL);
+  for (j = 0; j < epidemics; j++)
+    total += cost[j] = ic_cost(ic+j, g, growth);
+  first[0] = 0;
+  for (j = 0, k = 1; k < num_shards; k++) {
+    while (j < epidemics && sum + cost[j]/2.0 < total * k / num_shards)
+      sum += cost[j++];
+    first[k] = j;
+  }
+  first[num_shards] = epidemics;
+  free(cost);
+  return first;
+}
+
+/**
+   Worker of shard 'shard' of the job 'arg', in its own process
+*/
+void shard_work(int shard, void *arg) {
+  ShardJob *job = (ShardJob *) arg;
+  char path[MAX_PATH_LENGTH+16];
+  FILE *trace_output = NULL, *stats_output, *results_output = NULL;
+  TraceOutput *stage = NULL;
+  TraceStats *stats = NULL;
+  ResultsTable *results = NULL;
+  EpidemicTasks tasks;
+  int first = job->first[shard], count = job->first[shard+1] - first;
+
+  fprintf(stderr,"%s- shard %d (process %d): epidemics %d to %d ...\n",
+	  tstamp(), shard, (int) getpid(), first, first+count-1);
+  fflush(stderr);
+  srand((unsigned)time(NULL) ^ (2654435761u * (unsigned)getpid())); // not the draws of the launcher
+  if (job->trace_path) { // binary, merged into the trace of the run
+    trace_output = fopen(shard_path(path, job->trace_path, shard), "w");
+    assert(trace_output != NULL);
+    stage = traceoutput_new(trace_output, TRACE_BINARY, 4, 2*job->threads*(job->interleave+1),
+			    0, 0);
+  }
+  if (job->stats_path)
+    stats = tracestats_new();
+  if (job->results_path) {
+    results_output = fopen(shard_path(path, job->results_path, shard), "w");
+    assert(results_output != NULL);
+    results = results_new(results_output, 0);
+  }
+
+  tasks_init(&tasks, job->threads, job->growth, job->g, job->ic + first, count, NULL,
+	     job->maxtime, job->stop_criterion);
+  simulate_run(&tasks, job->p, job->g, job->samples, job->interleave, stage, NULL, NULL, NULL,
+	       job->sample_rate, job->step_events, stats, results, job->data_output,
+	       job->trace_output_path);
+  tasks_clean(&tasks);
+
+  if (stage) {
+    traceoutput_destroy(stage);
+    fclose(trace_output);
+  }
+  if (results) {
+    results_destroy(results);
+    fclose(results_output);
+  }
+  if (stats) {
+    stats_output = fopen(shard_path(path, job->stats_path, shard), "w");
+    assert(stats_output != NULL);
+    tracestats_write(stats, stats_output);
+    fclose(stats_output);
+    tracestats_destroy(stats);
+  }
+}
+
+// Distributed runs: one process per part of the graph (see partition.h)
+typedef struct _PartJob {
+  char *prefix;           // parts PREFIX.partK of the graph
+  InitialCondition *ic;
+  int epidemics;
+  double p;
+  int samples;
+  double sample_rate;
+  int step_events;
+  char *trace_path;       // outputs of the run, NULL if none: the
+  char *stats_path;       // processes write to PATH.shardK
+  char *results_path;
+  FILE *data_output;
+  char *trace_output_path;
+} PartJob;
+
+/**
+   Infection attempt of the owned node v by a provider at time t
+*/
+inline void part_infect(int *times, int *order, int *next, int v, int t, long *infected,
+			long *links, TraceStats *stats) {
+  if (!times[v]) {
+    times[v] = t+1;
+    order[(*next)++] = v;
+    (*infected)++;
+    (*links)++;
+    if (stats)
+      tracestats_infection(stats, t, t+1);
+  } else if (times[v] == t+1)
+    (*links)++;
+}
+
+/**
+   Runs 'ic' (bounded in time) over the parts of the graph, one per
+   process of 't', level by level: each process runs the providers of the
+   level it owns, sends the clients that are ghosts to their owners, which
+   infect them at the next level, then the counts of the level are summed
+   over the processes. 'times' (zero) and 'order' hold the owned nodes;
+   fills 'row' with the size, links, end time and depth of the epidemic
+*/
+void epidemic_distributed(Transport *t, GraphPart *gp, InitialCondition *ic, double p,
+			  int *times, int *order, Messages *out, Messages *in,
+			  TraceWriter *output, TraceStats *stats, ResultRow *row) {
+  int i, k, u, v, x, level, begin = 0, end = 0, next, last = 1;
+  long counts[3]; // active nodes, infections and links of a level
+
+  if (output && !tracewriter_begin(output, ic->id, 0))
+    output = NULL; // not sampled: no events at all
+  for (i = 0; i < ic->num_infected; i++)
+    if ((u = partition_local(gp, ic->infected[i])) >= 0 && !times[u]) {
+      times[u] = 1; // the initial time
+      order[end++] = u;
+    }
+  counts[0] = end;
+  transport_sum(t, counts, 1, out, in);
+  row->size          = ic->num_infected;
+  row->cascade_links = 0;
+
+  for (level = 1; counts[0] > 0 && level <= ic->bound; level++) {
+    next = end;
+    counts[1] = counts[2] = 0;
+    for (x = begin; x < end; x++) {
+      u = order[x]; // provider
+      for (i = gp->offsets[u]; i < gp->offsets[u+1]; i++)
+	if ( (double)rand() <= (double)RAND_MAX * p ) {
+	  v = gp->targets[i]; // client
+	  if (output) // print output: t P C F
+	    tracewriter_event(output, level, gp->ids[u], gp->ids[v]);
+	  if (stats)
+	    tracestats_event(stats, level);
+	  if (v < gp->owned)
+	    part_infect(times, order, &next, v, level, counts+1, counts+2, stats);
+	  else
+	    messages_add(out, gp->ghost_part[v - gp->owned], gp->ghost_index[v - gp->owned]);
+	}
+    }
+    t->exchange(t, out, in);
+    for (k = 0; k < t->size; k++) {
+      for (i = 0; i < in->count[k]; i++)
+	part_infect(times, order, &next, in->data[k][i], level, counts+1, counts+2, stats);
+      out->count[k] = 0;
+    }
+    begin = end;
+    end   = next;
+    counts[0] = end - begin;
+    transport_sum(t, counts, 3, out, in);
+    row->size          += counts[1];
+    row->cascade_links += counts[2];
+    if (counts[1] > 0)
+      last = level;
+  }
+
+  for (x = 0; x < end; x++)
+    times[order[x]] = 0;
+  row->id        = ic->id;
+  row->branch    = 0;
+  row->seeds     = ic->num_infected;
+  row->bound     = ic->bound;
+  row->end_time  = last;
+  row->max_depth = (row->size > ic->num_infected)? last+1 : 1;
+}
+
+/**
+   Process of part 't->rank' of the job 'arg'; the first one reports the
+   epidemics and writes their rows of results
+*/
+void part_work(Transport *t, void *arg) {
+  PartJob *job = (PartJob *) arg;
+  char path[MAX_PATH_LENGTH+16];
+  int i, sample, *times, *order;
+  double wall_time;
+  FILE *input, *trace_output = NULL, *stats_output, *results_output = NULL;
+  GraphPart *gp;
+  TraceOutput *stage = NULL;
+  TraceWriter *writer = NULL;
+  TraceStats *stats = NULL;
+  ResultsTable *results = NULL;
+  ResultsWriter *results_writer = NULL;
+  Messages *out = messages_new(t->size), *in = messages_new(t->size);
+  ResultRow row;
+
+  input = fopen(partition_path(path, job->prefix, t->rank), "r");
+  assert(input != NULL);
+  gp = partition_read(input);
+  assert(gp != NULL && gp->part == t->rank && gp->num_parts == t->size);
+  fclose(input);
+  fprintf(stderr,"%s- part %d (process %d): %d nodes, %d ghosts, %ld arcs\n",
+	  tstamp(), gp->part, (int) getpid(), gp->owned, gp->ghosts, gp->arcs);
+  fflush(stderr);
+  srand((unsigned)time(NULL) ^ (2654435761u * (unsigned)getpid())); // not the draws of the launcher
+  times = (int *) calloc(gp->owned + 1, sizeof(int));
+  order = (int *) malloc((gp->owned + 1) * sizeof(int));
+  assert(times != NULL && order != NULL);
+
+  if (job->trace_path) { // binary, merged into the trace of the run
+    trace_output = fopen(shard_path(path, job->trace_path, t->rank), "w");
+    assert(trace_output != NULL);
+    stage = traceoutput_new(trace_output, TRACE_BINARY, 4, 2, 0, 0);
+    writer = tracewriter_new(stage);
+    tracewriter_sample(writer, job->sample_rate, job->step_events);
+  }
+  if (job->stats_path)
+    stats = tracestats_new();
+  if (job->results_path) { // empty but for the first part
+    results_output = fopen(shard_path(path, job->results_path, t->rank), "w");
+    assert(results_output != NULL);
+    results = results_new(results_output, 0);
+    results_writer = resultswriter_new(results);
+  }
+
+  for (i = 0; i < job->epidemics; i++)
+    for (sample = 1; sample <= job->samples; sample++) {
+      if (t->rank == 0 && sample == 1) {
+	fprintf(stderr,"%s- parts: running epidemic %d with p = %f upto %s = %d %s%s ...\n",
+		tstamp(), job->ic[i].id, job->p, stopc_description[MaxTime], job->ic[i].bound,
+		!job->trace_output_path? "" : ", output: ",
+		!job->trace_output_path? "" : job->trace_output_path);
+	fflush(stderr);
+      }
+      wall_time = results_clock();
+      epidemic_distributed(t, gp, job->ic + i, job->p, times, order, out, in, writer, stats, &row);
+      row.sample    = sample;
+      row.wall_time = results_clock() - wall_time;
+      if (t->rank > 0)
+	continue;
+      if (stats) {
+	stats->max_depth = row.max_depth;
+	tracestats_epidemic(stats, row.size);
+      }
+      if (results_writer)
+	resultswriter_add(results_writer, &row);
+      if (job->data_output) {
+	fprintf(job->data_output,
+		"Epidemic %d #%d: stopped at t = %d with %d / %d ( %.2f%% ) infected nodes and %d links\n",
+		row.id, sample, row.end_time, row.size, gp->n, 100.0*(float)row.size/(float)gp->n,
+		row.cascade_links);
+	fflush(job->data_output);
+      }
+    }
+
+  if (writer) {
+    tracewriter_destroy(writer);
+    traceoutput_destroy(stage);
+    fclose(trace_output);
+  }
+  if (results) {
+    resultswriter_destroy(results_writer);
+    results_destroy(results);
+    fclose(results_output);
+  }
+  if (stats) {
+    stats_output = fopen(shard_path(path, job->stats_path, t->rank), "w");
+    assert(stats_output != NULL);
+    tracestats_write(stats, stats_output);
+    fclose(stats_output);
+    tracestats_destroy(stats);
+  }
+  messages_destroy(out, t->size);
+  messages_destroy(in, t->size);
+  free(times);
+  free(order);
+  partition_destroy(gp);
+}
+
+#ifndef SCASCADE_LIBRARY // the library (libscascade.c) includes this file without main
 /**
    Main
 */
 int main(int argc, char **argv) {
-  int i, j, epidemics, tid = 0;
+  int i, epidemics = 0;
   char epidemic_output_path[MAX_PATH_LENGTH] = "";
-  FILE *graph_input, *ic_list_input, *bounds_list_input, 	\
+  FILE *graph_input, *ic_list_input, *bounds_list_input, *candidates_input, \
     *data_output = NULL, *epidemic_output = NULL;
+  TraceOutput *stage = NULL;     // output thread of the trace
+  TraceWriter *writer;           // merges the traces of the shards
+  RequestSink *requests = NULL;
+  TraceStats *stats = NULL;      // aggregate statistics
+  FILE *stats_output, *results_output = NULL;
+  ResultsTable *results = NULL;  // table of results per epidemic
+  ResultsWriter *results_writer; // merges the tables of the shards
+  ShardJob job;                  // worker processes, if any
+  PartJob part_job;              // processes of a distributed run, if any
   graph *g;
-  InitialCondition *ic;
-  Epidemic *epidemic;
+  InitialCondition *ic = NULL;   // all the epidemics ...
+  ICStream *stream = NULL;       // ... or streamed from the list (simulation only)
+  EpidemicTasks tasks;           // the epidemics, by estimated cost, over the threads
   Stopc stop_criterion;
 
   // default parameters
   double p               = 0;    // neighbor infection probability
+  double p_last          = 0;    // sweep over p, p+p_step, ..., p_last
+  double p_step          = 0;
+  double *pgrid          = NULL;
+  int num_p              = 0;
+  int *candidates        = NULL; // candidate seeds for what-if evaluations
+  int num_candidates     = 0;
   int maxtime            = 0;    // global maximum epidemic simulation time
+  int top_k              = 0;    // number of seeds selected by RR sets
+  long rr_sets           = 100000; // number of RR sets
   int sample_epidemics   = 1;    // number of sample epidemics
   int threads            = 1;    // number of threads
+  int interleave         = 1;    // epidemics interleaved by each thread
+  int shards             = 1;    // worker processes
+  int parts              = 0;    // processes of a distributed run, one per part
+  int nodes              = 0;    // of the graph
+  int workers;                   // processes whose outputs are merged
+  int part;                      // of the first part of the graph, read ...
+  char part_path[MAX_PATH_LENGTH+16]; // ... to know the number of parts
+  int trace_fmt          = TRACE_TEXT; // trace file format
+  int trace_level        = 0;    // compression level of the trace
+  double sample_rate     = 1.0;  // fraction of the epidemics traced
+  int step_events        = 0;    // events traced per time step (0: all)
+  int percolation        = 0;    // final sizes only, by bond percolation
   char *graph_path       = NULL; // input path for graph (network) file
+  char *parts_prefix     = NULL; // input prefix of the parts of the graph
   char *ic_list_path     = NULL; // input path for list of epidemic initial parameters
   char *bounds_list_path = NULL; // input path for list of epidemic bounds
   char *trace_output_path= NULL; // output path for trace
+  char *candidates_path  = NULL; // input path for list of candidate seeds
+  char *stats_output_path= NULL; // output path for aggregate statistics
+  char *results_output_path= NULL; // output path for the table of results
+  double startup;                // wall clock at the start of the loading
 
   // parameter parsing
-  char syntax[] = "\n General parameters (required):\n\t -p SPREADING_PROBABILITY\n\t -g GRAPH_PATH\n\n \
+  char syntax[] = "\n General parameters (required):\n\t -p SPREADING_PROBABILITY (or sweep FIRST:LAST:STEP, max time only)\n\t -g GRAPH_PATH (or -D PARTS_PREFIX, distributed over the parts of the graph, max time only)\n\n \
 Simulation bounds (one required choice among the options):\n\t -t GLOBAL_MAX_TIME\n\t -a MAX_TIME_LIST_PATH\n\t -b MAX_INFECTED_LIST_PATH\n\n \
 Initial conditions (optional):\n\t -i INITIAL_CONDITIONS_DATA_PATH\n\t -r NUM_RAND_EPIDEMICS\n\n \
-Misc parameters (optional):\n\t -s NUM_SAMPLE_EPIDEMICS\n\t -h NUM_THREADS\n \t -e [STATUS_OUTPUT_PATH]\n\t -o EPIDEMIC_DIR_OUTPUT\n\n";
+Misc parameters (optional):\n\t -s NUM_SAMPLE_EPIDEMICS\n\t -h NUM_THREADS\n\t -I EPIDEMICS_PER_THREAD (interleaved, to overlap their cache misses)\n\t -P NUM_SHARDS (worker processes on ranges of the epidemics, sharing the graph)\n \t -e [STATUS_OUTPUT_PATH]\n\t -o EPIDEMIC_DIR_OUTPUT\n\t -f TRACE_FORMAT (text, binary or requests)\n\t -z[LEVEL] (deflate the trace by blocks, 1-9)\n\t -y SAMPLE_RATE (trace a fraction of the epidemics, by id)\n\t -Y STEP_EVENTS (trace a sample of events per time step)\n\t -S STATS_OUTPUT_PATH (aggregate statistics, with or without trace)\n\t -E RESULTS_OUTPUT_PATH (binary table of results, one row per epidemic)\n\n \
+Final sizes only (no bounds, no trace):\n\t -c (one percolated graph per sample)\n\n \
+What-if of candidate seeds (max time only, no trace):\n\t -w CANDIDATE_SEEDS_LIST_PATH\n\n \
+Seed selection by RR sets (max time or no bounds, no trace):\n\t -k NUM_SEEDS\n\t -n NUM_RR_SETS\n\n";
   fprintf(stderr, "SIMPLE EPIDEMIC CASCADE SIMULATION:\n\n");
-  while ((i = getopt(argc, argv, "e::o:p:s:g:i:t:a:b:h:r:")) != -1)
+  while ((i = getopt(argc, argv, "e::o:f:z::y:Y:S:E:p:s:g:D:i:t:a:b:h:I:P:r:cw:k:n:")) != -1)
     switch (i) {
     case 'p':
-      p = atof(optarg);
+      if (!strchr(optarg, ':') && sscanf(optarg, "%lf", &p) == 1) // a single p
+	p_step = 0.0;
+      else if (sscanf(optarg, "%lf:%lf:%lf", &p, &p_last, &p_step) == 3) // a sweep
+	assert(p_step > 0.0);
+      else {
+	fputs(syntax, stderr);
+	abort();
+      }
       break;
     case 'e':
       if (optarg)
@@ -309,12 +1512,37 @@ Misc parameters (optional):\n\t -s NUM_SAMPLE_EPIDEMICS\n\t -h NUM_THREADS\n \t
     case 'o':
       trace_output_path = optarg;
       break;
+    case 'f':
+      trace_fmt = trace_format(optarg);
+      assert(trace_fmt >= 0);
+      break;
+    case 'z':
+      trace_level = optarg? atoi(optarg) : TRACEZIP_LEVEL;
+      assert(trace_level >= 1 && trace_level <= 9);
+      break;
+    case 'y':
+      sample_rate = atof(optarg);
+      assert(sample_rate > 0.0 && sample_rate <= 1.0);
+      break;
+    case 'Y':
+      step_events = atoi(optarg);
+      assert(step_events > 0);
+      break;
+    case 'S':
+      stats_output_path = optarg;
+      break;
+    case 'E':
+      results_output_path = optarg;
+      break;
     case 's':
       sample_epidemics = atoi(optarg);
       break;
     case 'g':
       graph_path = optarg;
       break;
+    case 'D':
+      parts_prefix = optarg;
+      break;
     case 'i':
       assert(epidemics == 0);
       ic_list_path = optarg;
@@ -337,16 +1565,49 @@ Misc parameters (optional):\n\t -s NUM_SAMPLE_EPIDEMICS\n\t -h NUM_THREADS\n \t
     case 'h':
       threads = atoi(optarg);
       break;
+    case 'I':
+      interleave = atoi(optarg);
+      break;
+    case 'P':
+      shards = atoi(optarg);
+      break;
+    case 'c':
+      percolation = 1;
+      break;
+    case 'w':
+      candidates_path = optarg;
+      break;
+    case 'k':
+      top_k = atoi(optarg);
+      break;
+    case 'n':
+      rr_sets = atol(optarg);
+      break;
     case '?':
       fputs(syntax, stderr);
     default:
       abort();
     }
   assert(p > 0.0 && p <= 1.0);
+  if (p_step > 0.0) { // grid of probabilities for a coupled sweep
+    assert(p_last >= p && p_last <= 1.0);
+    num_p = (int) ((p_last-p)/p_step + 0.5) + 1;
+    pgrid = (double *) malloc(num_p * sizeof(double));
+    assert(pgrid != NULL);
+    for (i = 0; i < num_p; i++)
+      pgrid[i] = (i == num_p-1)? p_last : p + i*p_step;
+    assert(!percolation);
+  }
   assert(sample_epidemics > 0);
-  assert(graph_path || ic_list_path);
-  assert(bounds_list_path || maxtime > 0);
-  assert(threads > 0);
+  assert(graph_path || parts_prefix || ic_list_path);
+  assert(bounds_list_path || maxtime > 0 || percolation || top_k);
+  assert(!top_k || (!bounds_list_path && !percolation && !pgrid && rr_sets > 0));
+  assert(!stats_output_path || (!percolation && !pgrid && !candidates_path && !top_k));
+  assert(!results_output_path || (!percolation && !pgrid && !candidates_path && !top_k));
+  assert(threads > 0 && interleave > 0 && shards > 0);
+  assert(shards == 1 || (!percolation && !pgrid && !candidates_path && !top_k));
+  assert(!parts_prefix || (!percolation && !pgrid && !candidates_path && !top_k && shards == 1 &&
+			   stop_criterion == MaxTime && !graph_path));
 
   // preliminaires
   srand((unsigned)time(NULL));
@@ -358,29 +1619,54 @@ Misc parameters (optional):\n\t -s NUM_SAMPLE_EPIDEMICS\n\t -h NUM_THREADS\n \t
   fflush(stderr);
 
   // load underlying graph
-  fprintf(stderr,"%s\nLoading the graph %s...\n", tstamp(), graph_path? graph_path : "");
-  fflush(stderr);
-  if (!graph_path)
-    graph_input = stdin;
-  else 
-    graph_input = fopen(graph_path, "r");
-  assert(graph_input != NULL);
-  g = graph_from_file(graph_input);
-  if (graph_input != stdin)
+  startup = results_clock();
+  if (parts_prefix) { // each process loads its part
+    graph_input = fopen(partition_path(part_path, parts_prefix, 0), "r");
+    assert(graph_input != NULL);
+    i = partition_header(graph_input, &part, &parts, &nodes);
+    assert(i && part == 0);
     fclose(graph_input);
-  fprintf(stderr,"  Loaded graph with %d nodes, %d links.\n\n", g->n, g->m);
+    g = NULL;
+    fprintf(stderr,"%s\nGraph %s of %d nodes in %d parts.\n\n", tstamp(), parts_prefix, nodes, parts);
+  } else {
+    fprintf(stderr,"%s\nLoading the graph %s...\n", tstamp(), graph_path? graph_path : "");
+    fflush(stderr);
+    if (!graph_path)
+      graph_input = stdin;
+    else
+      graph_input = fopen(graph_path, "r");
+    assert(graph_input != NULL);
+    g = graph_from_file(graph_input);
+    if (graph_input != stdin)
+      fclose(graph_input);
+    nodes = g->n;
+    fprintf(stderr,"  Loaded graph with %d nodes, %d links.\n\n", g->n, g->m);
+  }
+  if (shards > 1) { // one copy for all the worker processes
+    graph_share(g);
+    fprintf(stderr,"  Graph shared by %d worker processes.\n\n", shards);
+  }
   fflush(stderr);
 
   // set list of initial conditions
   fprintf(stderr,"%s\n Loading list of epidemics %s...\n", tstamp(), ic_list_path? ic_list_path : "");
   fflush(stderr);
-  if (ic_list_path) { // load from file
+  if (ic_list_path && !percolation && !pgrid && !candidates_path && !top_k && shards == 1 &&
+      !parts_prefix) {
+    ic_list_input = fopen(ic_list_path, "r"); // parsed by batches along the simulation
+    bounds_list_input = maxtime? NULL : fopen(bounds_list_path, "r");
+    stream = icstream_open(ic_list_input, bounds_list_input, ICSTREAM_BATCH, 2*threads+1, 0);
+    epidemics = stream->epidemics;
+    fclose(ic_list_input);
+    if (bounds_list_input)
+      fclose(bounds_list_input);
+  } else if (ic_list_path) { // load from file
     ic_list_input = fopen(ic_list_path, "r");
     epidemics = ic_import(&ic, ic_list_input, 0);
     fclose(ic_list_input);
   } else if (epidemics > 0) { // infect randomly 'epidemics' epidemics
     fprintf(stderr,"  No list of initial conditions given; loading %d epidemics with 1 randomly infected node...\n", epidemics);
-    ic = ic_random_epidemics(epidemics, g->n);
+    ic = ic_random_epidemics(epidemics, nodes);
   } else {
     fprintf(stderr,"  No list of initial conditions given; using 1 epidemic with 1 infected node...\n");
     epidemics = 1;
@@ -391,7 +1677,13 @@ Misc parameters (optional):\n\t -s NUM_SAMPLE_EPIDEMICS\n\t -h NUM_THREADS\n \t
   fprintf(stderr,"Setting bounds (%s) for epidemics...\n", 
 	  bounds_list_path? bounds_list_path : ":global:");
   fflush(stderr);
-  if(maxtime)
+  if (percolation)
+    fprintf(stderr,"  Bounds ignored: final sizes by percolation.\n");
+  else if (top_k && !maxtime)
+    fprintf(stderr,"  No bounds: RR sets without depth limit.\n");
+  else if (stream)
+    fprintf(stderr,"  Bounds %s.\n", maxtime? "set as the epidemics are run" : "streamed with the epidemics");
+  else if(maxtime)
     for(i = 0; i < epidemics; i++) {
       ic[i].bound = maxtime;
       ic[i].stop_criterion = MaxTime;
@@ -401,68 +1693,169 @@ Misc parameters (optional):\n\t -s NUM_SAMPLE_EPIDEMICS\n\t -h NUM_THREADS\n \t
     ic_import_bounds(ic, epidemics, stop_criterion, bounds_list_input);
     fclose(bounds_list_input);
   }
-  fprintf(stderr,"  Loaded %d epidemics.\n\n", epidemics);
+  fprintf(stderr,"  %s %d epidemics.\n", stream? "Streaming" : "Loaded", epidemics);
+  fprintf(stderr,"  Startup (graph and lists) took %.3f s.\n\n", results_clock() - startup);
   fflush(stderr);
 
+  // list of candidate seeds
+  if (candidates_path) {
+    assert(!percolation && !pgrid);
+    candidates_input = fopen(candidates_path, "r");
+    assert(candidates_input != NULL);
+    num_candidates = import_nodes(&candidates, candidates_input, g->n);
+    fclose(candidates_input);
+    fprintf(stderr,"  Loaded %d candidate seeds.\n\n", num_candidates);
+    fflush(stderr);
+  }
+
   // set global epidemic_output
-  assert(sample_epidemics == 1);
+  assert(sample_epidemics == 1 || percolation || pgrid || candidates);
+  assert(trace_fmt != TRACE_REQUESTS || !trace_level);
+  if (trace_output_path && strlen(trace_output_path) > 0) {
+    if (percolation)
+      sprintf(epidemic_output_path,"%s-finalsize.list",trace_output_path);
+    else if (top_k)
+      sprintf(epidemic_output_path,"%s-seeds.initial",trace_output_path);
+    else if (pgrid)
+      sprintf(epidemic_output_path,"%s-%s.sweep",trace_output_path,stopc_description[stop_criterion]);
+    else if (candidates)
+      sprintf(epidemic_output_path,"%s-%s.whatif",trace_output_path,stopc_description[stop_criterion]);
+    else
+      sprintf(epidemic_output_path,"%s-%s.%s",trace_output_path,stopc_description[stop_criterion],
+	      trace_extension(trace_fmt, trace_level > 0));
+  }
+
+  // sharded run: the workers write to files of their own, merged below
+  if (shards > 1) {
+    job.ic                = ic;
+    job.growth            = graph_growth(g, p);
+    job.first             = shard_ranges(ic, epidemics, shards, g, job.growth);
+    job.p                 = p;
+    job.g                 = g;
+    job.maxtime           = maxtime;
+    job.stop_criterion    = stop_criterion;
+    job.samples           = sample_epidemics;
+    job.threads           = threads;
+    job.interleave        = interleave;
+    job.sample_rate       = sample_rate;
+    job.step_events       = step_events;
+    job.trace_path        = (trace_output_path && strlen(trace_output_path) > 0)? epidemic_output_path : NULL;
+    job.stats_path        = stats_output_path;
+    job.results_path      = results_output_path;
+    job.data_output       = data_output;
+    job.trace_output_path = trace_output_path;
+    fprintf(stderr,"%s\nRunning %d shards...\n", tstamp(), shards);
+    fflush(stderr);
+    i = shards_run(shards, shard_work, &job);
+    if (i > 0) { // the outputs of the others are left for inspection
+      fprintf(stderr,"  %d shards failed; stopping.\n", i);
+      exit(1);
+    }
+    fprintf(stderr,"%s\n  All shards done; merging their outputs...\n", tstamp());
+    fflush(stderr);
+  } else if (parts_prefix) {
+    part_job.prefix            = parts_prefix;
+    part_job.ic                = ic;
+    part_job.epidemics         = epidemics;
+    part_job.p                 = p;
+    part_job.samples           = sample_epidemics;
+    part_job.sample_rate       = sample_rate;
+    part_job.step_events       = step_events;
+    part_job.trace_path        = (trace_output_path && strlen(trace_output_path) > 0)? epidemic_output_path : NULL;
+    part_job.stats_path        = stats_output_path;
+    part_job.results_path      = results_output_path;
+    part_job.data_output       = data_output;
+    part_job.trace_output_path = trace_output_path;
+    fprintf(stderr,"%s\nRunning over %d parts...\n", tstamp(), parts);
+    fflush(stderr);
+    i = transport_spawn(parts, part_work, &part_job);
+    if (i > 0) { // a part cannot run alone: the run fails with it
+      fprintf(stderr,"  %d parts failed; stopping.\n", i);
+      exit(1);
+    }
+    fprintf(stderr,"%s\n  All parts done; merging their outputs...\n", tstamp());
+    fflush(stderr);
+  }
+  workers = (shards > 1)? shards : parts;
+
   if (trace_output_path && strlen(trace_output_path) > 0) {
-    sprintf(epidemic_output_path,"%s-%s.trace",trace_output_path,stopc_description[stop_criterion]);
     epidemic_output = fopen(epidemic_output_path, "w");
     assert(epidemic_output != NULL);
+    if (percolation || pgrid || candidates || top_k)
+      ; // plain text lists
+    else if (trace_fmt == TRACE_REQUESTS) // written at the end, in time order
+      requests = requests_new(epidemic_output);
+    else { // two blocks per writer: one filled while the other is written
+      stage = traceoutput_new(epidemic_output, trace_fmt, 4, 2*threads*(interleave+1),
+			      trace_level, 0);
+      traceoutput_index(stage, traceindex_create(epidemic_output_path, 0, 0));
+    }
   } else
     epidemic_output = NULL;
+  if (stats_output_path) // counted by each thread, merged at the end
+    stats = tracestats_new();
+  if (results_output_path) { // row groups appended by each thread
+    results_output = fopen(results_output_path, "w");
+    assert(results_output != NULL);
+    results = results_new(results_output, 0);
+  }
 
-  #if PARALLEL
-  #pragma omp parallel default(none)					\
-  private(tid,epidemic,i,j)						\
-  shared(stderr,stopc_description,p,g,ic,epidemics,sample_epidemics,data_output,\
-	 stop_criterion,trace_output_path,  epidemic_output,epidemic_output_path)
-  #endif
-  {
-  #if PARALLEL
-    tid = omp_get_thread_num();
-    #pragma omp for schedule(guided)
-  #endif
-    for (j = 0; j < epidemics; j++) {
-      fprintf(stderr,"%s- thread %d: running epidemic %d with p = %f upto %s = %d %s%s ...\n",
-	      tstamp(), tid, ic[j].id, p, stopc_description[stop_criterion], ic[j].bound,
-	      !trace_output_path? "" : ", output: ", !trace_output_path? "" : trace_output_path);
-      fflush(stderr);
-      
-      for (i = 1; i <= sample_epidemics; i++) {
-	epidemic = epidemic_new(p, g, ic+j, epidemic_output);
-	
-	if (data_output) {
-	  fprintf(data_output,
-		  "Epidemic %d #%d: started at t = %d with %d / %d ( %.2f%% ) infected nodes\n",
-		  epidemic->id,i, epidemic->t, epidemic->num_infected,
-		  epidemic->g->n, 100.0*(float)epidemic->num_infected/(float)epidemic->g->n);
-	  fflush(data_output);
-	}
-
-	epidemic_run(epidemic);
-
-	if (epidemic_output)
-	  fflush(epidemic_output);
-
-	if (data_output) {
-	  fprintf(data_output, 
-		  "Epidemic %d #%d: stopped at t = %d with %d / %d ( %.2f%% ) infected nodes and %d links\n",
-		  epidemic->id,i, epidemic->t, epidemic->num_infected,
-		  epidemic->g->n, 100.0*(float)epidemic->num_infected/(float)epidemic->g->n,
-		  epidemic->cascade_links);
-	  fflush(data_output);
-	}
-
-	epidemic_destroy(epidemic);
-      }
-      ic_clean(ic+j);
+  if (top_k) // seeds of maximum estimated spread, no forward simulation
+    rrsets_seeds(p, g, maxtime, rr_sets, top_k, data_output, epidemic_output);
+  else if (percolation) // final sizes only: one union-find pass per sample
+    percolation_epidemics(p, g, ic, epidemics, sample_epidemics, data_output, epidemic_output);
+  else if (pgrid) // whole grid of p's at once, with common random numbers
+    sweep_epidemics(pgrid, num_p, g, ic, epidemics, sample_epidemics, data_output, epidemic_output);
+  else if (candidates) // each candidate seed added to and removed from the seeds
+    whatif_epidemics(p, g, ic, epidemics, sample_epidemics, candidates, num_candidates,
+		     data_output, epidemic_output);
+  else if (workers > 0) { // merge, in the order of the shards or parts
+    if (stage || requests) {
+      writer = requests? tracewriter_requests(requests) : tracewriter_new(stage);
+      fprintf(stderr,"  Merged %ld trace events.\n",
+	      shards_merge_trace(epidemic_output_path, workers, writer));
+      tracewriter_destroy(writer);
+    }
+    if (stats)
+      shards_merge_stats(stats_output_path, workers, stats);
+    if (results) {
+      results_writer = resultswriter_new(results);
+      shards_merge_results(results_output_path, workers, results_writer);
+      resultswriter_destroy(results_writer);
     }
+    if (shards > 1)
+      free(job.first);
+  } else {
+    tasks_init(&tasks, threads, graph_growth(g, p), g, ic, epidemics, stream, maxtime,
+	       stop_criterion);
+    simulate_run(&tasks, p, g, sample_epidemics, interleave, stage, requests, NULL, NULL,
+		 sample_rate, step_events, stats, results, data_output, trace_output_path);
+    tasks_clean(&tasks);
   }
+  if (stream)
+    icstream_close(stream);
   // close global epidemic_output
+  if (stage)
+    traceoutput_destroy(stage);
+  if (requests) {
+    fprintf(stderr,"%s\nWriting %ld events as requests...\n", tstamp(), requests->num_events);
+    fprintf(stderr,"  Written %ld requests.\n", requests_write(requests));
+    requests_destroy(requests);
+  }
   if (epidemic_output)
     fclose(epidemic_output);
+  if (results) {
+    fprintf(stderr,"  Written %ld rows of results.\n", results->rows);
+    results_destroy(results);
+    fclose(results_output);
+  }
+  if (stats) {
+    stats_output = fopen(stats_output_path, "w");
+    assert(stats_output != NULL);
+    tracestats_write(stats, stats_output);
+    fclose(stats_output);
+    tracestats_destroy(stats);
+  }
 
   // clean up and exit
   if (data_output && data_output != stdout)
@@ -471,7 +1864,13 @@ Misc parameters (optional):\n\t -s NUM_SAMPLE_EPIDEMICS\n\t -h NUM_THREADS\n \t
   fputc('\n', stderr);
   fprintf(stderr,"%s\nDone.\n", tstamp());
   fflush(stderr);
-  free_graph(g);
-  free(ic);
+  if (shards > 1)
+    graph_unshare(g);
+  else if (g)
+    free_graph(g);
+  ic_free(ic);
+  free(pgrid);
+  free(candidates);
   return 0;
 }
+#endif
@@ -0,0 +1,150 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+
+  Header: the simulation engine of scascade as a library (libscascade.a,
+  libscascade.so), for programs that run many jobs on the same graph. A
+  graph and a set of epidemics are loaded once, then run any number of
+  times with different configurations; the results and the trace of a
+  run are handed to callbacks instead of being written to files.
+
+    ScascadeGraph *g = scascade_graph_load("er.graph");
+    ScascadeEpidemics *e = scascade_epidemics_random(g, 1000, SCASCADE_MAX_DEPTH, 10);
+    ScascadeConfig config;
+    ScascadeSinks sinks = {on_result, NULL, &totals};
+    scascade_config_init(&config);
+    config.p = 0.1;
+    scascade_run(g, e, &config, &sinks);
+
+  The graph and the epidemics are read only during a run: they can be
+  shared by the runs of several threads. The runs draw from the generator
+  of the process (rand), which the library seeds only for a run given a
+  seed: such a run is reproducible only if it is the only one at a time.
+  See scascade.hpp for C++.
+*/
+#ifndef SCASCADE_H
+#define SCASCADE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define SCASCADE_API __attribute__((visibility("default")))
+#else
+#define SCASCADE_API
+#endif
+
+typedef struct _ScascadeGraph ScascadeGraph;
+typedef struct _ScascadeEpidemics ScascadeEpidemics;
+
+/**
+   Bound of the epidemics of a set: their depth (time steps, as -t or -a
+   of scascade) or their size (infected nodes, as -b)
+*/
+typedef enum _ScascadeBound {SCASCADE_MAX_DEPTH, SCASCADE_MAX_SIZE} ScascadeBound;
+
+typedef struct _ScascadeConfig {
+  double p;                // neighbour infection probability
+  int samples;             // runs of each epidemic
+  int threads;             // of the run
+  int interleave;          // epidemics interleaved by each thread
+  double trace_rate;       // fraction of the epidemics traced
+  int step_events;         // events traced per time step (0: all)
+  unsigned int seed;       // of the draws (0: those of the process go on)
+  int verbose;             // status line of each epidemic on stderr
+} ScascadeConfig;
+
+typedef struct _ScascadeResult {
+  int id;                  // epidemic id
+  int sample;              // 1..samples
+  int seeds;               // initially infected nodes
+  int bound;
+  int size;                // final number of infected nodes
+  int max_depth;
+  int cascade_links;
+  int end_time;            // time of the last event
+  double wall_time;        // seconds
+} ScascadeResult;
+
+typedef struct _ScascadeEvent {
+  int t;                   // time
+  int provider;            // infected node ...
+  int client;              // ... and its neighbour, infected now or before
+  int id;                  // epidemic id (the same for all its samples)
+  int branch;              // 0
+} ScascadeEvent;
+
+/**
+   Receivers of a run, each optional: 'result' gets the row of each
+   epidemic as it ends, one at a time; 'trace' gets the events by
+   batches, from several threads at once (the events of a batch are of
+   one thread, in the order of its epidemics)
+*/
+typedef struct _ScascadeSinks {
+  void (*result)(void *user, const ScascadeResult *result);
+  void (*trace)(void *user, const ScascadeEvent *events, int count);
+  void *user;
+} ScascadeSinks;
+
+/**
+   Graph of a file in the format of scascade (see README), NULL if the
+   file cannot be opened; a malformed file ends the program, as in
+   scascade. scascade_graph_new builds the graph of 'n' nodes and the 'm'
+   links links[2i] -- links[2i+1], NULL if a node is out of range
+*/
+SCASCADE_API ScascadeGraph *scascade_graph_load(const char *path);
+SCASCADE_API ScascadeGraph *scascade_graph_new(int n, int m, const int *links);
+SCASCADE_API int scascade_graph_nodes(const ScascadeGraph *g);
+SCASCADE_API int scascade_graph_links(const ScascadeGraph *g);
+SCASCADE_API void scascade_graph_free(ScascadeGraph *g);
+
+/**
+   Empty set of epidemics bounded by 'bound'; scascade_epidemics_add
+   appends the epidemic 'id' of the 'num_seeds' seeds 'seeds' (copied),
+   up to 'limit'
+*/
+SCASCADE_API ScascadeEpidemics *scascade_epidemics_new(ScascadeBound bound);
+SCASCADE_API void scascade_epidemics_add(ScascadeEpidemics *e, int id, const int *seeds,
+					 int num_seeds, int limit);
+
+/**
+   Epidemics of a list of initial conditions and of a list of bounds (in
+   the formats of -i and -a/-b of scascade), or all bounded by 'limit' if
+   'bounds_path' is NULL; NULL if a file cannot be opened
+*/
+SCASCADE_API ScascadeEpidemics *scascade_epidemics_load(const char *initial_path,
+							const char *bounds_path,
+							ScascadeBound bound, int limit);
+
+/**
+   'count' epidemics 0..count-1 of one random seed of 'g' each
+*/
+SCASCADE_API ScascadeEpidemics *scascade_epidemics_random(const ScascadeGraph *g, int count,
+							  ScascadeBound bound, int limit);
+SCASCADE_API int scascade_epidemics_count(const ScascadeEpidemics *e);
+SCASCADE_API void scascade_epidemics_free(ScascadeEpidemics *e);
+
+/**
+   Defaults of scascade: p = 0, one sample, one thread, no interleaving,
+   all the events traced, no seed, quiet
+*/
+SCASCADE_API void scascade_config_init(ScascadeConfig *config);
+
+/**
+   Runs the samples of the epidemics 'e' on 'g' into 'sinks' (NULL: no
+   output); returns the number of epidemics run, or -1 if the
+   configuration is invalid or a seed is not a node of 'g'
+*/
+SCASCADE_API int scascade_run(const ScascadeGraph *g, const ScascadeEpidemics *e,
+			      const ScascadeConfig *config, const ScascadeSinks *sinks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,133 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  SIR process such that infected nodes become recovered in one time step
+  Output: the complete trace of the spreading -- ie, including the spread
+  attempts to removed individuals.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+
+  Header: C++ (11) interface of the scascade library, over scascade.h.
+  The graph and the epidemics own their C objects; the sinks of a run
+  are functions, eg lambdas:
+
+    scascade::Graph g("er.graph");
+    scascade::Epidemics e = scascade::Epidemics::random(g, 1000, SCASCADE_MAX_DEPTH, 10);
+    scascade::Config config;
+    config.p = 0.1;
+    scascade::run(g, e, config, [&](const ScascadeResult &r) { sizes.push_back(r.size); });
+*/
+#ifndef SCASCADE_HPP
+#define SCASCADE_HPP
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "scascade.h"
+
+namespace scascade {
+
+typedef std::function<void (const ScascadeResult &)> ResultSink;
+typedef std::function<void (const ScascadeEvent *, int)> TraceSink;
+
+class Graph {
+public:
+  explicit Graph(const std::string &path) : g(scascade_graph_load(path.c_str())) {
+    if (!g)
+      throw std::runtime_error("scascade: cannot open the graph " + path);
+  }
+  /**
+     Graph of 'n' nodes and the links links[2i] -- links[2i+1]
+  */
+  Graph(int n, const std::vector<int> &links)
+    : g(scascade_graph_new(n, (int)(links.size() / 2), links.data())) {
+    if (!g)
+      throw std::invalid_argument("scascade: link to a node out of range");
+  }
+  Graph(Graph &&other) : g(other.g) { other.g = nullptr; }
+  Graph &operator=(Graph &&other) { std::swap(g, other.g); return *this; }
+  Graph(const Graph &) = delete;
+  Graph &operator=(const Graph &) = delete;
+  ~Graph() { scascade_graph_free(g); }
+
+  int nodes() const { return scascade_graph_nodes(g); }
+  int links() const { return scascade_graph_links(g); }
+  const ScascadeGraph *get() const { return g; }
+
+private:
+  ScascadeGraph *g;
+};
+
+class Epidemics {
+public:
+  explicit Epidemics(ScascadeBound bound = SCASCADE_MAX_DEPTH) : e(scascade_epidemics_new(bound)) {}
+  /**
+     Lists of initial conditions and of bounds (empty: all bounded by 'limit')
+  */
+  Epidemics(const std::string &initial_path, const std::string &bounds_path,
+	    ScascadeBound bound, int limit = 0)
+    : e(scascade_epidemics_load(initial_path.c_str(),
+				bounds_path.empty()? nullptr : bounds_path.c_str(), bound, limit)) {
+    if (!e)
+      throw std::runtime_error("scascade: cannot open the epidemics " + initial_path);
+  }
+  static Epidemics random(const Graph &g, int count, ScascadeBound bound, int limit) {
+    return Epidemics(scascade_epidemics_random(g.get(), count, bound, limit));
+  }
+  Epidemics(Epidemics &&other) : e(other.e) { other.e = nullptr; }
+  Epidemics &operator=(Epidemics &&other) { std::swap(e, other.e); return *this; }
+  Epidemics(const Epidemics &) = delete;
+  Epidemics &operator=(const Epidemics &) = delete;
+  ~Epidemics() { scascade_epidemics_free(e); }
+
+  void add(int id, const std::vector<int> &seeds, int limit) {
+    if (seeds.empty())
+      throw std::invalid_argument("scascade: epidemic without seeds");
+    scascade_epidemics_add(e, id, seeds.data(), (int)seeds.size(), limit);
+  }
+  int count() const { return scascade_epidemics_count(e); }
+  const ScascadeEpidemics *get() const { return e; }
+
+private:
+  explicit Epidemics(ScascadeEpidemics *e) : e(e) {}
+  ScascadeEpidemics *e;
+};
+
+struct Config : ScascadeConfig {
+  Config() { scascade_config_init(this); }
+};
+
+namespace detail {
+struct Sinks {
+  const ResultSink *result;
+  const TraceSink *trace;
+};
+
+inline void result(void *user, const ScascadeResult *r) {
+  (*static_cast<Sinks *>(user)->result)(*r);
+}
+
+inline void trace(void *user, const ScascadeEvent *events, int count) {
+  (*static_cast<Sinks *>(user)->trace)(events, count);
+}
+}
+
+/**
+   Runs the epidemics 'e' on 'g' (see scascade_run); 'trace' is called
+   from several threads at once, and neither sink may throw (they are
+   called from the threads of the run). Returns the number of epidemics run
+*/
+inline int run(const Graph &g, const Epidemics &e, const Config &config,
+	       const ResultSink &result = ResultSink(), const TraceSink &trace = TraceSink()) {
+  detail::Sinks user = {&result, &trace};
+  ScascadeSinks sinks = {result? detail::result : nullptr, trace? detail::trace : nullptr, &user};
+  int epidemics = scascade_run(g.get(), e.get(), &config, &sinks);
+  if (epidemics < 0)
+    throw std::invalid_argument("scascade: invalid configuration or seed");
+  return epidemics;
+}
+
+}
+
+#endif
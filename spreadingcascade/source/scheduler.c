@@ -0,0 +1,141 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  Work-stealing scheduler of the epidemics of a run. Each thread has a
+  deque of tasks (ids with an estimated cost), sorted largest first: the
+  owner takes its tasks from the front, so that the long epidemics start
+  early, and a thread out of work steals from the back of the others.
+  The threads out of work are counted, so that a long epidemic can be
+  shared with them and the run ends once all of them are.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <omp.h>
+
+typedef struct _Task {
+  int id;
+  double cost;            // estimated cost, in arcs scanned
+} Task;
+
+typedef struct _TaskDeque {
+  Task *tasks;
+  int begin, end;         // tasks[begin..end)
+  int capacity;
+  omp_lock_t lock;
+} TaskDeque;
+
+typedef struct _Scheduler {
+  int num_deques;         // one per thread
+  TaskDeque *deques;
+  int idle;               // threads out of work
+  omp_lock_t lock;        // of 'idle'
+} Scheduler;
+
+Scheduler *scheduler_new(int num_deques) {
+  int i;
+  Scheduler *s = (Scheduler *) calloc(1, sizeof(Scheduler));
+  assert(s != NULL && num_deques > 0);
+  s->num_deques = num_deques;
+  s->deques = (TaskDeque *) calloc(num_deques, sizeof(TaskDeque));
+  assert(s->deques != NULL);
+  for (i = 0; i < num_deques; i++)
+    omp_init_lock(&s->deques[i].lock);
+  omp_init_lock(&s->lock);
+  return s;
+}
+
+void scheduler_destroy(Scheduler *s) {
+  int i;
+  assert(s != NULL);
+  for (i = 0; i < s->num_deques; i++) {
+    omp_destroy_lock(&s->deques[i].lock);
+    free(s->deques[i].tasks);
+  }
+  omp_destroy_lock(&s->lock);
+  free(s->deques);
+  free(s);
+}
+
+/**
+   Largest cost first, then by id
+*/
+static int task_compare(const void *a, const void *b) {
+  const Task *x = (const Task *) a, *y = (const Task *) b;
+  if (x->cost != y->cost)
+    return (x->cost < y->cost)? 1 : -1;
+  return (x->id > y->id) - (x->id < y->id);
+}
+
+static void deque_append(TaskDeque *d, Task *task) {
+  if (d->end == d->capacity) {
+    if (d->begin > 0) { // room at the front: move the tasks there
+      memmove(d->tasks, d->tasks + d->begin, (d->end - d->begin) * sizeof(Task));
+      d->end -= d->begin;
+      d->begin = 0;
+    } else {
+      d->capacity = d->capacity? 2*d->capacity : 1024;
+      d->tasks = (Task *) realloc(d->tasks, d->capacity * sizeof(Task));
+      assert(d->tasks != NULL);
+    }
+  }
+  d->tasks[d->end++] = *task;
+}
+
+/**
+   Sorts the 'n' tasks and appends them to deque 'd'
+*/
+void scheduler_push(Scheduler *s, int d, Task *tasks, int n) {
+  int i;
+  TaskDeque *q = s->deques + d;
+  qsort(tasks, n, sizeof(Task), task_compare);
+  omp_set_lock(&q->lock);
+  for (i = 0; i < n; i++)
+    deque_append(q, tasks+i);
+  omp_unset_lock(&q->lock);
+}
+
+/**
+   Sorts the 'n' tasks and deals them to the deques in turn, so that each
+   thread starts with a share of the large ones
+*/
+void scheduler_deal(Scheduler *s, Task *tasks, int n) {
+  int i;
+  qsort(tasks, n, sizeof(Task), task_compare);
+  for (i = 0; i < n; i++)
+    deque_append(s->deques + i % s->num_deques, tasks+i);
+}
+
+/**
+   Takes the largest task of deque 'd'; returns 0 if it is empty
+*/
+int scheduler_pop(Scheduler *s, int d, Task *task) {
+  int found;
+  TaskDeque *q = s->deques + d;
+  omp_set_lock(&q->lock);
+  found = (q->begin < q->end);
+  if (found)
+    *task = q->tasks[q->begin++];
+  omp_unset_lock(&q->lock);
+  return found;
+}
+
+/**
+   Takes the smallest task of another deque than 'd', trying them in turn
+   from the next one; returns 0 if they are all empty
+*/
+int scheduler_steal(Scheduler *s, int d, Task *task) {
+  int i, found = 0;
+  TaskDeque *q;
+  for (i = 1; i < s->num_deques && !found; i++) {
+    q = s->deques + (d+i) % s->num_deques;
+    omp_set_lock(&q->lock);
+    found = (q->begin < q->end);
+    if (found)
+      *task = q->tasks[--q->end];
+    omp_unset_lock(&q->lock);
+  }
+  return found;
+}
@@ -0,0 +1,211 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  Sharded runs: worker processes forked on ranges of the epidemics, for
+  crash isolation and under per-process memory caps. The graph is copied
+  once into a read-only shared mapping before the fork, so that the
+  workers share it (and a worker writing to it crashes instead of
+  corrupting it); each worker writes its trace (binary), statistics and
+  results to files of its own, PATH.shardK, merged by the launcher once
+  all of them are done. A worker that crashes is run again, alone.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define SHARD_RETRIES 2   // runs of a crashed worker, after the first one
+
+static void *graph_image = NULL;
+static size_t graph_image_size = 0;
+
+/**
+   Moves the links and degrees of 'g' into one shared read-only mapping
+*/
+void graph_share(graph *g) {
+  int i;
+  long offset = 0;
+  unsigned char *image;
+  int **links;
+  int *degrees, *arcs;
+
+  graph_image_size = g->n * (sizeof(int *) + sizeof(int)) + 2L * g->m * sizeof(int);
+  image = (unsigned char *) mmap(NULL, graph_image_size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  assert(image != MAP_FAILED);
+  links   = (int **) image;
+  degrees = (int *) (image + g->n * sizeof(int *));
+  arcs    = degrees + g->n;
+  for (i = 0; i < g->n; i++) {
+    links[i]   = arcs + offset;
+    degrees[i] = g->degrees[i];
+    memcpy(links[i], g->links[i], g->degrees[i] * sizeof(int));
+    offset += g->degrees[i];
+  }
+  free(g->links[0]);
+  free(g->links);
+  free(g->degrees);
+  free(g->capacities);
+  g->links      = links;
+  g->degrees    = degrees;
+  g->capacities = NULL;
+  graph_image   = image;
+  mprotect(image, graph_image_size, PROT_READ);
+}
+
+void graph_unshare(graph *g) {
+  assert(graph_image != NULL);
+  munmap(graph_image, graph_image_size);
+  graph_image = NULL;
+  free(g);
+}
+
+/**
+   Output file of worker 'shard' for 'path'
+*/
+char *shard_path(char *buf, const char *path, int shard) {
+  sprintf(buf, "%s.shard%d", path, shard);
+  return buf;
+}
+
+static pid_t shard_fork(int shard, void (*work)(int, void *), void *arg) {
+  pid_t pid;
+  fflush(NULL); // nothing buffered is written twice
+  pid = fork();
+  assert(pid >= 0);
+  if (pid == 0) {
+    work(shard, arg);
+    fflush(NULL);
+    _exit(0);
+  }
+  return pid;
+}
+
+static int shard_failed(int shard, int status) {
+  if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+    return 0;
+  if (WIFSIGNALED(status))
+    fprintf(stderr, "  Shard %d killed by signal %d.\n", shard, WTERMSIG(status));
+  else
+    fprintf(stderr, "  Shard %d exited with status %d.\n", shard, WEXITSTATUS(status));
+  return 1;
+}
+
+/**
+   Runs work(k, arg) in a worker process for each shard k < num_shards,
+   all at once, then the failed ones again, one at a time; returns the
+   number of shards that still failed
+*/
+int shards_run(int num_shards, void (*work)(int, void *), void *arg) {
+  int k, j, status, failures = 0;
+  pid_t pid, *pids = (pid_t *) malloc(num_shards * sizeof(pid_t));
+  int *failed = (int *) calloc(num_shards, sizeof(int));
+  assert(pids != NULL && failed != NULL);
+
+  for (k = 0; k < num_shards; k++)
+    pids[k] = shard_fork(k, work, arg);
+  for (j = 0; j < num_shards; j++) {
+    pid = wait(&status);
+    for (k = 0; k < num_shards && pids[k] != pid; k++)
+      ;
+    assert(k < num_shards);
+    failed[k] = shard_failed(k, status);
+  }
+  for (k = 0; k < num_shards; k++) {
+    for (j = 0; failed[k] && j < SHARD_RETRIES; j++) {
+      fprintf(stderr, "  Running shard %d again (%d/%d)...\n", k, j+1, SHARD_RETRIES);
+      pid = shard_fork(k, work, arg);
+      waitpid(pid, &status, 0);
+      failed[k] = shard_failed(k, status);
+    }
+    failures += failed[k];
+  }
+  free(pids);
+  free(failed);
+  return failures;
+}
+
+/**
+   Hands the events of the binary traces of the shards of 'path' to 'tw'
+   (all of them: the workers sampled already), then removes them; returns
+   the number of events
+*/
+long shards_merge_trace(const char *path, int num_shards, TraceWriter *tw) {
+  int k;
+  long events = 0;
+  char buf[4096];
+  FILE *in;
+  TraceReader *tr;
+  TraceEvent ev;
+
+  for (k = 0; k < num_shards; k++) {
+    in = fopen(shard_path(buf, path, k), "r");
+    assert(in != NULL);
+    tr = tracereader_new(in);
+    while (tracereader_next(tr, &ev)) {
+      tracewriter_begin(tw, ev.f, ev.b);
+      tracewriter_event(tw, ev.t, ev.p, ev.c);
+      events++;
+    }
+    tracereader_destroy(tr);
+    fclose(in);
+    unlink(buf);
+  }
+  return events;
+}
+
+/**
+   Adds the rows of the tables of the shards of 'path' to 'rw', then
+   removes them
+*/
+void shards_merge_results(const char *path, int num_shards, ResultsWriter *rw) {
+  int k, r;
+  char buf[4096];
+  ResultsFile *rf;
+  ResultsGroup g;
+  ResultRow row;
+
+  for (k = 0; k < num_shards; k++) {
+    rf = results_map(shard_path(buf, path, k));
+    assert(rf != NULL && rf->num_columns == RESULTS_COLUMNS);
+    while (results_next(rf, &g))
+      for (r = 0; r < g.rows; r++) { // the columns in the order of ResultRow
+	row.id            = ((const int *) g.columns[0])[r];
+	row.sample        = ((const int *) g.columns[1])[r];
+	row.branch        = ((const int *) g.columns[2])[r];
+	row.seeds         = ((const int *) g.columns[3])[r];
+	row.bound         = ((const int *) g.columns[4])[r];
+	row.size          = ((const int *) g.columns[5])[r];
+	row.max_depth     = ((const int *) g.columns[6])[r];
+	row.cascade_links = ((const int *) g.columns[7])[r];
+	row.end_time      = ((const int *) g.columns[8])[r];
+	row.wall_time     = ((const double *) g.columns[9])[r];
+	resultswriter_add(rw, &row);
+      }
+    results_unmap(rf);
+    unlink(buf);
+  }
+}
+
+/**
+   Adds the statistics of the shards of 'path' to 'ts', then removes them
+*/
+void shards_merge_stats(const char *path, int num_shards, TraceStats *ts) {
+  int k, ok;
+  char buf[4096];
+  FILE *in;
+
+  for (k = 0; k < num_shards; k++) {
+    in = fopen(shard_path(buf, path, k), "r");
+    assert(in != NULL);
+    ok = tracestats_read(ts, in);
+    assert(ok);
+    fclose(in);
+    unlink(buf);
+  }
+}
@@ -0,0 +1,159 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  Coupled sweep over a grid of spreading probabilities. Each arc draws a
+  single uniform threshold U, shared by every p of the grid (the arc is
+  live for p iff U <= p), so one traversal gives the outcome for all p.
+
+  A node v is infected at time t for every p >= c_t(v), where c_t(v) is
+  the smallest bottleneck threshold over paths of at most t-1 arcs from
+  the seeds; c_t is computed level by level, relaxing only the nodes
+  whose threshold improved at the previous level.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+*/
+
+#define SWEEP_UNSET 2.0   // above any probability: not infected for any p
+
+typedef struct _Sweep {
+  int n;                  // number of nodes
+  int num_p;              // size of the probability grid
+  double *p;              // increasing grid of probabilities
+  double *c;              // threshold up to the current level
+  double *cnew;           // threshold up to the next level
+  int *frontier;          // nodes improved at the current level
+  int *next;              // nodes improved at the next level
+  int *touched;           // nodes with a threshold set
+  int num_touched;
+  int max_bound;          // rows allocated in 'incidence'
+  int *incidence;         // new infections per (time, p index)
+} Sweep;
+
+Sweep *sweep_new(graph *g, double *p, int num_p) {
+  int i;
+  Sweep *sw = (Sweep *) malloc(sizeof(Sweep));
+  assert(sw != NULL);
+  assert(num_p > 0);
+  sw->n         = g->n;
+  sw->num_p     = num_p;
+  sw->p         = p;
+  sw->c         = (double *) malloc(g->n * sizeof(double));
+  sw->cnew      = (double *) malloc(g->n * sizeof(double));
+  sw->frontier  = (int *) malloc(g->n * sizeof(int));
+  sw->next      = (int *) malloc(g->n * sizeof(int));
+  sw->touched   = (int *) malloc(g->n * sizeof(int));
+  assert(sw->c && sw->cnew && sw->frontier && sw->next && sw->touched);
+  for (i = 0; i < g->n; i++)
+    sw->c[i] = sw->cnew[i] = SWEEP_UNSET;
+  sw->num_touched = 0;
+  sw->max_bound   = 0;
+  sw->incidence   = NULL;
+  return sw;
+}
+
+void sweep_destroy(Sweep *sw) {
+  assert(sw != NULL);
+  free(sw->c);
+  free(sw->cnew);
+  free(sw->frontier);
+  free(sw->next);
+  free(sw->touched);
+  free(sw->incidence);
+  free(sw);
+}
+
+/**
+   Index of the smallest p in the grid such that p >= x (num_p if none)
+*/
+int sweep_index(Sweep *sw, double x) {
+  int lo = 0, hi = sw->num_p, mid;
+  while (lo < hi) {
+    mid = (lo+hi)/2;
+    if (sw->p[mid] < x)
+      lo = mid+1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/**
+   Node whose threshold drops from c_old to c_new at time t: infected at
+   time t for the p's of the grid in [c_new, c_old[
+*/
+inline void sweep_record(Sweep *sw, int t, double c_new, double c_old) {
+  int *row = sw->incidence + t*(sw->num_p+1);
+  row[sweep_index(sw, c_new)]++;
+  row[sweep_index(sw, c_old)]--;
+}
+
+/**
+   Runs the epidemic from 'seeds' up to time 'bound' for the whole grid of
+   probabilities; on return incidence[t*(num_p+1)+k] holds the number of
+   nodes infected at time t for p[k]
+*/
+void sweep_run(Sweep *sw, graph *g, int *seeds, int k, int bound, uint64_t seed) {
+  int i, j, t, u, v, num_frontier = 0, num_next, *tmp;
+  double w, pmax = sw->p[sw->num_p-1];
+
+  for (i = 0; i < sw->num_touched; i++) {
+    v = sw->touched[i];
+    sw->c[v] = sw->cnew[v] = SWEEP_UNSET;
+  }
+  sw->num_touched = 0;
+  if (bound+2 > sw->max_bound) {
+    sw->max_bound = bound+2;
+    sw->incidence = (int *) realloc(sw->incidence,
+				    sw->max_bound*(sw->num_p+1)*sizeof(int));
+    assert(sw->incidence != NULL);
+  }
+  memset(sw->incidence, 0, (bound+2)*(sw->num_p+1)*sizeof(int));
+
+  for (i = 0; i < k; i++) {
+    v = seeds[i];
+    if (sw->c[v] == 0.0)
+      continue;
+    sw->c[v] = sw->cnew[v] = 0.0;
+    sw->frontier[num_frontier++] = v;
+    sw->touched[sw->num_touched++] = v;
+    sweep_record(sw, 1, 0.0, SWEEP_UNSET);
+  }
+
+  for (t = 1; t <= bound && num_frontier > 0; t++) {
+    num_next = 0;
+    for (i = 0; i < num_frontier; i++) {
+      u = sw->frontier[i];
+      for (j = 0; j < g->degrees[u]; j++) {
+	v = g->links[u][j];
+	w = coin_urand(seed, coin_link(u, v));
+	if (w < sw->c[u])
+	  w = sw->c[u];
+	if (w <= pmax && w < sw->cnew[v]) {
+	  if (sw->cnew[v] == sw->c[v])
+	    sw->next[num_next++] = v;
+	  sw->cnew[v] = w;
+	}
+      }
+    }
+    for (i = 0; i < num_next; i++) {
+      v = sw->next[i];
+      if (sw->c[v] == SWEEP_UNSET)
+	sw->touched[sw->num_touched++] = v;
+      sweep_record(sw, t+1, sw->cnew[v], sw->c[v]);
+      sw->c[v] = sw->cnew[v];
+    }
+    tmp = sw->frontier; sw->frontier = sw->next; sw->next = tmp;
+    num_frontier = num_next;
+  }
+
+  // prefix sums over the grid: from differences to counts
+  for (t = 1; t <= bound+1; t++)
+    for (j = 1; j < sw->num_p; j++)
+      sw->incidence[t*(sw->num_p+1)+j] += sw->incidence[t*(sw->num_p+1)+j-1];
+}
+
+/**
+   Number of nodes infected at time t for p[k], after sweep_run
+*/
+inline int sweep_incidence(Sweep *sw, int t, int k) {
+  return sw->incidence[t*(sw->num_p+1)+k];
+}
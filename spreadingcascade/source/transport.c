@@ -0,0 +1,232 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  Transports of the messages between the processes of a distributed
+  simulation, one per part of the graph. A transport exchanges arrays of
+  integers between all the processes at once, which is also a barrier;
+  it is a table of functions, so that other transports (eg, over TCP or
+  MPI, across hosts) plug in. The local one is a mesh of Unix socket
+  pairs between processes forked on this host, for tests and hosts with
+  many cores.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+typedef struct _Messages {
+  int **data;             // data[k][0..count[k]), to or from process k
+  int *count;
+  int *capacity;
+} Messages;
+
+typedef struct _Transport {
+  int rank, size;         // this process, of 'size'
+  void *state;
+  /**
+     Sends 'out' and receives 'in' (grown as needed), from every process;
+     returns once all of them have called it
+  */
+  void (*exchange)(struct _Transport *t, Messages *out, Messages *in);
+  void (*close)(struct _Transport *t);
+} Transport;
+
+Messages *messages_new(int size) {
+  Messages *m = (Messages *) malloc(sizeof(Messages));
+  assert(m != NULL);
+  m->data     = (int **) calloc(size, sizeof(int *));
+  m->count    = (int *) calloc(size, sizeof(int));
+  m->capacity = (int *) calloc(size, sizeof(int));
+  assert(m->data != NULL && m->count != NULL && m->capacity != NULL);
+  return m;
+}
+
+void messages_destroy(Messages *m, int size) {
+  int k;
+  for (k = 0; k < size; k++)
+    free(m->data[k]);
+  free(m->data);
+  free(m->count);
+  free(m->capacity);
+  free(m);
+}
+
+static void messages_reserve(Messages *m, int k, int count) {
+  if (count > m->capacity[k]) {
+    m->capacity[k] = (count > 2*m->capacity[k])? count : 2*m->capacity[k];
+    m->data[k] = (int *) realloc(m->data[k], m->capacity[k] * sizeof(int));
+    assert(m->data[k] != NULL);
+  }
+}
+
+/**
+   Appends 'x' to the messages to process 'k'
+*/
+inline void messages_add(Messages *m, int k, int x) {
+  if (m->count[k] == m->capacity[k])
+    messages_reserve(m, k, m->count[k] + 1);
+  m->data[k][m->count[k]++] = x;
+}
+
+/**
+   Global sums of the 'n' values 'x' (at most 16), in place
+*/
+void transport_sum(Transport *t, long *x, int n, Messages *out, Messages *in) {
+  int i, k;
+  long y[16];
+  assert(n <= 16);
+  for (k = 0; k < t->size; k++) {
+    out->count[k] = 0;
+    if (k != t->rank) {
+      messages_reserve(out, k, 2*n);
+      memcpy(out->data[k], x, n * sizeof(long)); // 2 ints per long
+      out->count[k] = 2*n;
+    }
+  }
+  t->exchange(t, out, in);
+  for (k = 0; k < t->size; k++)
+    if (k != t->rank) {
+      assert(in->count[k] == 2*n);
+      memcpy(y, in->data[k], n * sizeof(long));
+      for (i = 0; i < n; i++)
+	x[i] += y[i];
+    }
+  for (k = 0; k < t->size; k++)
+    out->count[k] = 0;
+}
+
+// Local transport: socket pairs between the processes forked by transport_spawn
+typedef struct _SocketMesh {
+  int size;
+  int *fds;               // fds[i*size + j]: end of process i towards j
+} SocketMesh;
+
+static void socket_write(int fd, const void *buf, long bytes) {
+  long n;
+  while (bytes > 0) {
+    n = write(fd, buf, bytes);
+    assert(n > 0); // a peer that died ends the run
+    buf = (const char *) buf + n;
+    bytes -= n;
+  }
+}
+
+static void socket_read(int fd, void *buf, long bytes) {
+  long n;
+  while (bytes > 0) {
+    n = read(fd, buf, bytes);
+    assert(n > 0);
+    buf = (char *) buf + n;
+    bytes -= n;
+  }
+}
+
+/**
+   Pairwise exchanges, with the peers in increasing order; of a pair, the
+   lower rank writes first. Every process takes its pairs in the same
+   global order, so that the blocking writes cannot deadlock
+*/
+static void socket_exchange(Transport *t, Messages *out, Messages *in) {
+  int k, count;
+  SocketMesh *mesh = (SocketMesh *) t->state;
+  int *fds = mesh->fds + t->rank * t->size;
+
+  for (k = 0; k < t->size; k++) {
+    in->count[k] = 0;
+    if (k == t->rank)
+      continue;
+    if (t->rank < k) {
+      socket_write(fds[k], out->count + k, sizeof(int));
+      socket_write(fds[k], out->data[k], out->count[k] * sizeof(int));
+    }
+    socket_read(fds[k], &count, sizeof(int));
+    messages_reserve(in, k, count);
+    socket_read(fds[k], in->data[k], count * sizeof(int));
+    in->count[k] = count;
+    if (t->rank > k) {
+      socket_write(fds[k], out->count + k, sizeof(int));
+      socket_write(fds[k], out->data[k], out->count[k] * sizeof(int));
+    }
+  }
+}
+
+static void socket_close(Transport *t) {
+  int k;
+  SocketMesh *mesh = (SocketMesh *) t->state;
+  for (k = 0; k < t->size; k++)
+    if (k != t->rank)
+      close(mesh->fds[t->rank * t->size + k]);
+  free(t);
+}
+
+typedef struct _Spawn {
+  SocketMesh mesh;
+  void (*work)(Transport *, void *);
+  void *arg;
+} Spawn;
+
+/**
+   Process 'rank': keeps its ends of the mesh only, and runs the work
+*/
+static void transport_rank(int rank, void *arg) {
+  int i;
+  Spawn *spawn = (Spawn *) arg;
+  Transport *t = (Transport *) malloc(sizeof(Transport));
+  assert(t != NULL);
+  for (i = 0; i < spawn->mesh.size * spawn->mesh.size; i++)
+    if (i / spawn->mesh.size != rank && spawn->mesh.fds[i] >= 0)
+      close(spawn->mesh.fds[i]);
+  t->rank     = rank;
+  t->size     = spawn->mesh.size;
+  t->state    = &spawn->mesh;
+  t->exchange = socket_exchange;
+  t->close    = socket_close;
+  spawn->work(t, spawn->arg);
+  t->close(t);
+}
+
+/**
+   Runs work(t, arg) in 'size' processes connected by a local transport
+   't'; returns the number of processes that failed. A process cannot be
+   run again alone: its peers fail with it
+*/
+int transport_spawn(int size, void (*work)(Transport *, void *), void *arg) {
+  int i, j, k, status, pair[2], failures = 0;
+  pid_t pid, *pids = (pid_t *) malloc(size * sizeof(pid_t));
+  Spawn spawn;
+
+  spawn.mesh.size = size;
+  spawn.mesh.fds  = (int *) malloc(size * size * sizeof(int));
+  assert(pids != NULL && spawn.mesh.fds != NULL);
+  spawn.work = work;
+  spawn.arg  = arg;
+  for (i = 0; i < size; i++) {
+    spawn.mesh.fds[i*size + i] = -1;
+    for (j = i+1; j < size; j++) {
+      k = socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+      assert(k == 0);
+      spawn.mesh.fds[i*size + j] = pair[0];
+      spawn.mesh.fds[j*size + i] = pair[1];
+    }
+  }
+  for (k = 0; k < size; k++)
+    pids[k] = shard_fork(k, transport_rank, &spawn);
+  for (i = 0; i < size * size; i++) // the ends are the processes' only
+    if (spawn.mesh.fds[i] >= 0)
+      close(spawn.mesh.fds[i]);
+  for (j = 0; j < size; j++) {
+    pid = wait(&status);
+    for (k = 0; k < size && pids[k] != pid; k++)
+      ;
+    assert(k < size);
+    failures += shard_failed(k, status);
+  }
+  free(pids);
+  free(spawn.mesh.fds);
+  return failures;
+}
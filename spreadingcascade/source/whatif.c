@@ -0,0 +1,197 @@
+/*
+  SIMPLE EPIDEMIC CASCADE SIMULATION:
+  Incremental what-if engine for seed sets. The live arcs of a sample are
+  fixed by counter-based coins (arc u -> v is live iff its coin is below
+  p), and the engine keeps the infection time of every node reached from
+  the current seeds within the time bound. Adding a seed only explores
+  the nodes whose infection time improves; removing one only recomputes
+  the nodes whose fastest infection went through it.
+
+  Daniel.Bernardes@lip6.fr, (c) 2011 ComplexNetworks.fr
+*/
+
+typedef struct _WhatIf {
+  graph *g;               // underlying graph (network)
+  double p;               // neighbor infection probability
+  int bound;              // nodes infected up to time bound+1
+  uint64_t seed;          // sample: fixes the live arcs
+  int num_infected;       // number of infected nodes
+  int *infected;          // infection time of each node (0: not infected)
+  int *seeds;             // multiplicity of each node in the seed set
+  char *seen;             // nodes touched since the last reset ...
+  int *touched;           // ... and their list
+  int num_touched;
+  int *region;            // nodes recomputed by a removal
+  int *candidates;        // region nodes sorted by time
+  int *queue;             // nodes in nondecreasing time order
+} WhatIf;
+
+WhatIf *whatif_new(graph *g, double p) {
+  WhatIf *w = (WhatIf *) malloc(sizeof(WhatIf));
+  assert(w != NULL);
+  w->g            = g;
+  w->p            = p;
+  w->num_infected = 0;
+  w->num_touched  = 0;
+  w->infected     = (int *) calloc(g->n, sizeof(int));
+  w->seeds        = (int *) calloc(g->n, sizeof(int));
+  w->seen         = (char *) calloc(g->n, sizeof(char));
+  w->touched      = (int *) malloc(g->n * sizeof(int));
+  w->region       = (int *) malloc(g->n * sizeof(int));
+  w->candidates   = (int *) malloc(g->n * sizeof(int));
+  w->queue        = (int *) malloc(g->n * sizeof(int));
+  assert(w->infected && w->seeds && w->seen && w->touched && w->region && w->candidates && w->queue);
+  return w;
+}
+
+void whatif_destroy(WhatIf *w) {
+  assert(w != NULL);
+  free(w->infected);
+  free(w->seeds);
+  free(w->seen);
+  free(w->touched);
+  free(w->region);
+  free(w->candidates);
+  free(w->queue);
+  free(w);
+}
+
+/**
+   Empties the seed set and fixes a new sample of live arcs
+*/
+void whatif_reset(WhatIf *w, int bound, uint64_t seed) {
+  int i, v;
+  for (i = 0; i < w->num_touched; i++) {
+    v = w->touched[i];
+    w->infected[v] = 0;
+    w->seeds[v]    = 0;
+    w->seen[v]     = 0;
+  }
+  w->num_touched  = 0;
+  w->num_infected = 0;
+  w->bound        = bound;
+  w->seed         = seed;
+}
+
+inline int whatif_live(WhatIf *w, int u, int v) {
+  return coin_urand(w->seed, coin_link(u, v)) < w->p;
+}
+
+inline void whatif_set(WhatIf *w, int v, int t) {
+  if (!w->infected[v])
+    w->num_infected++;
+  if (!w->seen[v]) {
+    w->seen[v] = 1;
+    w->touched[w->num_touched++] = v;
+  }
+  w->infected[v] = t;
+}
+
+/**
+   Relaxes the live arcs from the nodes of 'sorted' (k nodes in
+   nondecreasing order of time) and from the nodes they improve, merging
+   the two streams so that nodes are processed in order of time
+*/
+void whatif_relax(WhatIf *w, int *sorted, int k) {
+  int j, u, v, t, head = 0, tail = 0, next = 0;
+  graph *g = w->g;
+
+  while (next < k || head < tail) {
+    if (head < tail && (next == k || w->infected[w->queue[head]] <= w->infected[sorted[next]]))
+      u = w->queue[head++];
+    else
+      u = sorted[next++];
+    t = w->infected[u];
+    if (t == 0 || t > w->bound)
+      continue;
+    for (j = 0; j < g->degrees[u]; j++) {
+      v = g->links[u][j];
+      if ((!w->infected[v] || w->infected[v] > t+1) && whatif_live(w, u, v)) {
+	whatif_set(w, v, t+1);
+	w->queue[tail++] = v;
+      }
+    }
+  }
+}
+
+/**
+   Adds v to the seed set; returns the number of newly infected nodes
+*/
+int whatif_add(WhatIf *w, int v) {
+  int before = w->num_infected;
+  if (w->seeds[v]++ || w->infected[v] == 1)
+    return 0;
+  whatif_set(w, v, 1);
+  whatif_relax(w, &v, 1);
+  return w->num_infected - before;
+}
+
+/**
+   Removes v from the seed set; returns the number of nodes no longer
+   infected. The nodes whose fastest infection may go through v are the
+   descendants of v along tight live arcs (t(y) = t(x)+1); they are reset
+   and recomputed from the seeds among them and from their infected
+   neighbors outside.
+*/
+int whatif_remove(WhatIf *w, int v) {
+  int i, j, x, y, t, k = 0, num_region = 0, before = w->num_infected;
+  int max_t = 0, *count;
+  graph *g = w->g;
+
+  assert(w->seeds[v] > 0);
+  if (--w->seeds[v])
+    return 0;
+
+  // region: descendants of v along tight live arcs
+  w->region[num_region++] = v;
+  for (i = 0; i < num_region; i++) {
+    x = w->region[i];
+    t = (w->infected[x] < 0)? -w->infected[x] : w->infected[x];
+    if (t > w->bound)
+      continue;
+    for (j = 0; j < g->degrees[x]; j++) {
+      y = g->links[x][j];
+      if (w->infected[y] == t+1 && whatif_live(w, x, y)) {
+	w->infected[y] = -(t+1); // mark as in the region
+	w->region[num_region++] = y;
+      }
+    }
+  }
+  for (i = 0; i < num_region; i++)
+    w->infected[w->region[i]] = 0;
+  w->num_infected -= num_region;
+
+  // best time of each region node from its seeds and the nodes outside
+  for (i = 0; i < num_region; i++) {
+    y = w->region[i];
+    t = w->seeds[y]? 1 : 0;
+    for (j = 0; j < g->degrees[y] && t != 1; j++) {
+      x = g->links[y][j];
+      if (w->infected[x] > 0 && w->infected[x] <= w->bound &&
+	  (!t || w->infected[x]+1 < t) && whatif_live(w, x, y))
+	t = w->infected[x]+1;
+    }
+    if (t) {
+      w->infected[y] = t; // region nodes are already in the touched list
+      w->num_infected++;
+      max_t = (t > max_t)? t : max_t;
+    }
+  }
+
+  // counting sort of the restarted nodes by time, then relaxation
+  count = (int *) calloc(max_t+2, sizeof(int));
+  assert(count != NULL);
+  for (i = 0; i < num_region; i++)
+    if (w->infected[w->region[i]])
+      count[w->infected[w->region[i]]+1]++;
+  for (t = 1; t <= max_t; t++)
+    count[t+1] += count[t];
+  for (i = 0; i < num_region; i++)
+    if ((t = w->infected[w->region[i]]))
+      w->candidates[count[t]++] = w->region[i];
+  k = count[max_t];
+  free(count);
+  whatif_relax(w, w->candidates, k);
+
+  return before - w->num_infected;
+}